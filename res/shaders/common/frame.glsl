@@ -0,0 +1,10 @@
+#pragma once
+
+// per frame block, see FrameUniforms in uniform_blocks.hh
+layout(std140, binding = 0) uniform Frame
+{
+	mat4 VIEW;
+	mat4 PROJ;
+	mat4 VIEW_PROJ;
+	vec4 TIME;
+};
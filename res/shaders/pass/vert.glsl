@@ -1,16 +1,32 @@
 #version 430 core
+#include "common/frame.glsl"
 
 layout(location = 0) in vec3 attrPosition;
 layout(location = 1) in vec3 attrColor;
 
-out vec3 vertexColor;
+#ifdef INSTANCED
+// bind a sub-range with glBindBufferRange to draw a slice of the instances
+layout(std430, binding = 1) readonly buffer Instances
+{
+	mat4 models[];
+};
+#else
+// MVP is multiplied on the CPU, see UniformBlocks::object
+layout(std140, binding = 1) uniform Object
+{
+	mat4 MODEL;
+	mat4 MVP;
+};
+#endif
 
-uniform mat4 PROJ;
-uniform mat4 VIEW;
-uniform mat4 MODEL;
+out vec3 vertexColor;
 
 void main()
 {
-	gl_Position = PROJ * VIEW * MODEL * vec4(attrPosition, 1);
-   vertexColor = attrColor;
+#ifdef INSTANCED
+	gl_Position = VIEW_PROJ * models[gl_InstanceID] * vec4(attrPosition, 1);
+#else
+	gl_Position = MVP * vec4(attrPosition, 1);
+#endif
+	vertexColor = attrColor;
 }
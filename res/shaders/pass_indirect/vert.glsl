@@ -0,0 +1,28 @@
+#version 430 core
+#include "common/frame.glsl"
+
+layout(location = 0) in vec3 attrPosition;
+layout(location = 1) in vec3 attrColor;
+// instanced attribute, baseInstance of each indirect command selects the draw
+layout(location = 2) in uint attrDrawId;
+
+struct Draw
+{
+	mat4 model;
+	uint material;
+};
+
+layout(std430, binding = 0) readonly buffer Draws
+{
+	Draw draws[];
+};
+
+out vec3 vertexColor;
+flat out uint vertexMaterial;
+
+void main()
+{
+	gl_Position = VIEW_PROJ * draws[attrDrawId].model * vec4(attrPosition, 1);
+	vertexColor = attrColor;
+	vertexMaterial = draws[attrDrawId].material;
+}
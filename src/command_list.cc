@@ -0,0 +1,139 @@
+#include "command_list.hh"
+#include <taskflow.hpp>
+
+namespace
+{
+	struct BindBufferCmd { uint target; uint buf; };
+	struct BindBufferBaseCmd { uint target; uint index; uint buf; };
+	struct UniformV3Cmd { Programs::Handle handle; v3 value; };
+	struct UniformMat4Cmd { Programs::Handle handle; mat4 value; };
+	struct DrawElementsCmd { uint mode; u32 count; i32 baseVertex; uint type; size_t indexOffset; };
+	struct MultiDrawIndirectCmd { uint mode; u32 drawCount; uint type; size_t offset; };
+}
+
+void CommandList::useProgram(uint program)
+{
+	record(Op::UseProgram, program);
+}
+
+void CommandList::bindVertexArray(uint va)
+{
+	record(Op::BindVertexArray, va);
+}
+
+void CommandList::bindBuffer(uint target, uint buf)
+{
+	record(Op::BindBuffer, BindBufferCmd{ target, buf });
+}
+
+void CommandList::bindBufferBase(uint target, uint index, uint buf)
+{
+	record(Op::BindBufferBase, BindBufferBaseCmd{ target, index, buf });
+}
+
+void CommandList::uniform(Programs::Handle h, const v3 &v)
+{
+	record(Op::UniformV3, UniformV3Cmd{ h, v });
+}
+
+void CommandList::uniform(Programs::Handle h, const mat4 &m)
+{
+	record(Op::UniformMat4, UniformMat4Cmd{ h, m });
+}
+
+void CommandList::drawElements(uint mode, u32 count, i32 baseVertex, size_t indexOffset, uint type)
+{
+	record(Op::DrawElements, DrawElementsCmd{ mode, count, baseVertex, type, indexOffset });
+}
+
+void CommandList::multiDrawElementsIndirect(uint mode, u32 drawCount, size_t offset, uint type)
+{
+	record(Op::MultiDrawElementsIndirect, MultiDrawIndirectCmd{ mode, drawCount, type, offset });
+}
+
+void CommandList::replay(GL &gl, Programs &programs) const
+{
+	for (auto h = head; h; h = h->next)
+	{
+		switch (h->op)
+		{
+		case Op::UseProgram:
+			gl.program.use(payload<uint>(h));
+			break;
+		case Op::BindVertexArray:
+			gl.vertexArray.bind(payload<uint>(h));
+			break;
+		case Op::BindBuffer:
+		{
+			const auto &c = payload<BindBufferCmd>(h);
+			gl.buffer.bind(c.target, c.buf);
+			break;
+		}
+		case Op::BindBufferBase:
+		{
+			const auto &c = payload<BindBufferBaseCmd>(h);
+			gl.buffer.bindBase(c.target, c.index, c.buf);
+			break;
+		}
+		case Op::UniformV3:
+		{
+			const auto &c = payload<UniformV3Cmd>(h);
+			programs.uniform(c.handle, c.value);
+			break;
+		}
+		case Op::UniformMat4:
+		{
+			const auto &c = payload<UniformMat4Cmd>(h);
+			programs.uniform(c.handle, c.value);
+			break;
+		}
+		case Op::DrawElements:
+		{
+			const auto &c = payload<DrawElementsCmd>(h);
+			gl.draw.elementsBaseVertex(c.mode, c.count, c.baseVertex, c.indexOffset, c.type);
+			break;
+		}
+		case Op::MultiDrawElementsIndirect:
+		{
+			const auto &c = payload<MultiDrawIndirectCmd>(h);
+			gl.draw.multiElementsIndirect(c.mode, c.drawCount, c.offset, c.type);
+			break;
+		}
+		}
+	}
+}
+
+void CommandList::reset()
+{
+	arena.reset();
+	head = tail = nullptr;
+	count = 0;
+}
+
+void CommandLists::record(tf::Executor &executor, size_t jobs, const std::function<void(size_t, CommandList &)> &fn)
+{
+	if (lists.size() < jobs)
+		lists.resize(jobs);
+	for (auto &list : lists)
+		list.reset();
+
+	tf::Taskflow taskflow;
+	taskflow.parallel_for(size_t(0), jobs, size_t(1), [this, &fn](size_t job) {
+		fn(job, lists[job]);
+	});
+	executor.run(taskflow).get();
+}
+
+void CommandLists::replay(GL &gl, Programs &programs) const
+{
+	for (const auto &list : lists)
+		list.replay(gl, programs);
+}
+
+size_t CommandLists::size() const
+{
+	size_t total = 0;
+	for (const auto &list : lists)
+		total += list.size();
+	return total;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include "linear_arena.hh"
+#include "programs.hh"
+#include <functional>
+#include <new>
+#include <type_traits>
+
+namespace tf { class Executor; }
+
+// GL commands recorded on any thread and replayed later on the context
+// thread. Commands live in the list's own arena, so a list must only be
+// recorded by one thread at a time. Uniforms are recorded by handle and set
+// through Programs on replay, which keeps its shadow copies right; handles
+// have to be created up front, recording never touches GL or Programs.
+class CommandList
+{
+public:
+	void useProgram(uint program);
+	void bindVertexArray(uint va);
+	void bindBuffer(uint target, uint buf);
+	void bindBufferBase(uint target, uint index, uint buf);
+	void uniform(Programs::Handle h, const v3 &v);
+	void uniform(Programs::Handle h, const mat4 &m);
+	void drawElements(uint mode, u32 count, i32 baseVertex = 0, size_t indexOffset = 0, uint type = GL_UNSIGNED_INT);
+	void multiDrawElementsIndirect(uint mode, u32 drawCount, size_t offset = 0, uint type = GL_UNSIGNED_INT);
+
+	void replay(GL &gl, Programs &programs) const;
+	void reset();
+	size_t size() const { return count; }
+
+private:
+	enum class Op : u8
+	{
+		UseProgram,
+		BindVertexArray,
+		BindBuffer,
+		BindBufferBase,
+		UniformV3,
+		UniformMat4,
+		DrawElements,
+		MultiDrawElementsIndirect,
+	};
+
+	struct Header
+	{
+		Op op;
+		Header *next;
+	};
+
+	template <typename T>
+	void record(Op op, const T &payload)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "command payloads are copied bytewise");
+		constexpr size_t align = alignof(T) > alignof(Header) ? alignof(T) : alignof(Header);
+		constexpr size_t offset = (sizeof(Header) + alignof(T) - 1) & ~(alignof(T) - 1);
+
+		auto mem = static_cast<byte *>(arena.alloc(offset + sizeof(T), align));
+		auto header = new (mem) Header{ op, nullptr };
+		new (mem + offset) T(payload);
+
+		if (tail)
+			tail->next = header;
+		else
+			head = header;
+		tail = header;
+		++count;
+	}
+
+	template <typename T>
+	static const T& payload(const Header *h)
+	{
+		constexpr size_t offset = (sizeof(Header) + alignof(T) - 1) & ~(alignof(T) - 1);
+		return *reinterpret_cast<const T *>(reinterpret_cast<const byte *>(h) + offset);
+	}
+
+	LinearArena arena;
+	Header *head{ nullptr };
+	Header *tail{ nullptr };
+	size_t count{ 0 };
+};
+
+// A fixed set of command lists filled in parallel, one list per job, and
+// replayed in job order so the result does not depend on scheduling.
+class CommandLists
+{
+public:
+	void record(tf::Executor &executor, size_t jobs, const std::function<void(size_t job, CommandList &list)> &fn);
+	void replay(GL &gl, Programs &programs) const;
+	size_t size() const;
+
+private:
+	vector<CommandList> lists;
+};
@@ -1,4 +1,5 @@
 #include "default_app.hh"
+#include <taskflow.hpp>
 
 void DefaultApp::KeyCounter::reset()
 {
@@ -17,13 +18,24 @@ bool DefaultApp::KeyCounter::one()
 	return value == 1;
 }
 
+DefaultApp::DefaultApp() = default;
+
 DefaultApp::~DefaultApp()
 {
+	uploads.stop();
+	workers.reset();
 	if (wnd)
 		glfw.window.destroy(wnd);
 	glfw.terminate();
 }
 
+tf::Executor& DefaultApp::executor()
+{
+	if (!workers)
+		workers = std::make_unique<tf::Executor>();
+	return *workers;
+}
+
 bool DefaultApp::init(uint w, uint h, const string& title)
 {
 	if (!glfw.init())
@@ -52,7 +64,9 @@ bool DefaultApp::init(uint w, uint h, const string& title)
 
 	gl_printInfo();
 	gl_bindDebugCallback();
+	uploads.start(wnd);
 #ifdef _DEBUG
+	GL::State::current().validate = true;
 	moveToHalfRight();
 #endif
 	return true;
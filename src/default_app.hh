@@ -4,6 +4,10 @@
 #include "types.hh"
 #include "log.hh"
 #include "ui.hh"
+#include "upload_worker.hh"
+#include <memory>
+
+namespace tf { class Executor; }
 
 class DefaultApp
 {
@@ -18,9 +22,14 @@ class DefaultApp
 
 public:
 	GLFWwindow *wnd{ nullptr };
+	UploadWorker uploads;
 
-	bool init(uint w, uint h, const string& title);
+	DefaultApp();
 	~DefaultApp();
+	bool init(uint w, uint h, const string& title);
+
+	// worker pool shared by every subsystem, created once per process
+	tf::Executor& executor();
 
 	bool isOpen() const;
 	void close();
@@ -33,6 +42,7 @@ private:
 	unordered_map<int, KeyCounter> keyReleaseCount;
 	GLEW glew;
 	GLFW glfw;
+	std::unique_ptr<tf::Executor> workers;
 
 #ifdef _DEBUG
 	void moveToHalfRight();
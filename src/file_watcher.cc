@@ -0,0 +1,152 @@
+#include "file_watcher.hh"
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace fs = std::filesystem;
+
+FileWatcher::~FileWatcher()
+{
+	stop();
+}
+
+bool FileWatcher::watch(const string &_root, std::chrono::milliseconds _interval)
+{
+	stop();
+	root = _root;
+	interval = _interval;
+
+	std::error_code ec;
+	if (!fs::is_directory(root, ec))
+	{
+		std::cerr << "file_watcher: " << root << " is not a directory\n";
+		return false;
+	}
+
+#ifdef __linux__
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd >= 0)
+	{
+		bool ok = watchNative(root);
+		for (auto it = fs::recursive_directory_iterator(root, ec); ok && it != fs::recursive_directory_iterator(); it.increment(ec))
+			if (it->is_directory(ec))
+				ok = watchNative(it->path().string());
+		if (ok)
+			return true;
+		stop();
+	}
+	std::cerr << "file_watcher: inotify unavailable, polling " << root << "\n";
+#endif
+
+	// baseline so the first scan only reports later changes
+	scan(nullptr);
+	return true;
+}
+
+void FileWatcher::stop()
+{
+#ifdef __linux__
+	if (fd >= 0)
+		close(fd);
+#endif
+	fd = -1;
+	dirs.clear();
+	times.clear();
+}
+
+strings FileWatcher::poll()
+{
+	strings changed;
+	if (root.empty())
+		return changed;
+
+	if (native())
+		pollNative(changed);
+	else
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastScan < interval)
+			return changed;
+		lastScan = now;
+		scan(&changed);
+	}
+
+	std::sort(begin(changed), end(changed));
+	changed.erase(std::unique(begin(changed), end(changed)), end(changed));
+	return changed;
+}
+
+bool FileWatcher::watchNative(const string &dir)
+{
+#ifdef __linux__
+	int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd < 0)
+		return false;
+	dirs[wd] = dir;
+	return true;
+#else
+	(void)dir;
+	return false;
+#endif
+}
+
+void FileWatcher::pollNative(strings &changed)
+{
+#ifdef __linux__
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		auto len = read(fd, buffer, sizeof(buffer));
+		if (len <= 0)
+			break;
+
+		for (char *p = buffer; p < buffer + len;)
+		{
+			auto *event = reinterpret_cast<inotify_event *>(p);
+			p += sizeof(inotify_event) + event->len;
+
+			auto dir = dirs.find(event->wd);
+			if (dir == dirs.end() || event->len == 0)
+				continue;
+
+			auto path = (fs::path(dir->second) / event->name).string();
+			if (event->mask & IN_ISDIR)
+			{
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					watchNative(path);
+				continue;
+			}
+			// IN_CREATE alone is followed by IN_CLOSE_WRITE once the file is written
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				changed.push_back(path);
+		}
+	}
+#else
+	(void)changed;
+#endif
+}
+
+void FileWatcher::scan(strings *changed)
+{
+	std::error_code ec;
+	for (auto it = fs::recursive_directory_iterator(root, ec); it != fs::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (!it->is_regular_file(ec))
+			continue;
+
+		auto path = it->path().string();
+		auto time = it->last_write_time(ec);
+		auto found = times.find(path);
+		if (found == times.end() || found->second != time)
+		{
+			times[path] = time;
+			if (changed)
+				changed->push_back(path);
+		}
+	}
+}
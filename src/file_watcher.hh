@@ -0,0 +1,37 @@
+#pragma once
+#include "types.hh"
+#include <chrono>
+#include <filesystem>
+
+// Reports files written under a directory tree. Uses inotify on Linux and
+// falls back to comparing modification times every `interval` elsewhere or
+// when inotify is unavailable. poll() never blocks.
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	FileWatcher(const FileWatcher &) = delete;
+	FileWatcher& operator=(const FileWatcher &) = delete;
+	~FileWatcher();
+
+	bool watch(const string &root, std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+	void stop();
+
+	// changed files since the last call, each path once
+	strings poll();
+
+	bool native() const { return fd >= 0; }
+
+private:
+	bool watchNative(const string &dir);
+	void pollNative(strings &changed);
+	// records modification times, reports differences when changed is set
+	void scan(strings *changed);
+
+	string root;
+	int fd{ -1 };
+	unordered_map<int, string> dirs;
+	unordered_map<string, std::filesystem::file_time_type> times;
+	std::chrono::milliseconds interval{ 500 };
+	std::chrono::steady_clock::time_point lastScan;
+};
@@ -35,6 +35,27 @@ public:
 		return { false, "" };
 	}
 
+	static bool readBinary(const string &path, vector<byte> &out)
+	{
+		std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+		if (!in.is_open())
+			return false;
+
+		// directories open fine and seek to a bogus end on Linux, pipes can't seek
+		std::error_code ec;
+		if (!std::filesystem::is_regular_file(path, ec))
+			return false;
+
+		in.seekg(0, std::ios::end);
+		auto size = in.tellg();
+		if (size < 0)
+			return false;
+		out.resize(static_cast<size_t>(size));
+		in.seekg(0, std::ios::beg);
+		in.read(reinterpret_cast<char *>(out.data()), out.size());
+		return bool(in);
+	}
+
 	static bool isLoaded(const Files::ReadStatus& status)
 	{
 		return std::get<0>(status);
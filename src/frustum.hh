@@ -0,0 +1,32 @@
+#pragma once
+#include "types.hh"
+
+// Frustum planes extracted from a clip matrix (Gribb/Hartmann). Passing
+// PROJ * VIEW * MODEL gives planes in object space.
+struct Frustum
+{
+	v4 planes[6];
+
+	static Frustum from(const mat4 &m)
+	{
+		Frustum f;
+		auto row = [&m](int i) { return v4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+		f.planes[0] = row(3) + row(0);
+		f.planes[1] = row(3) - row(0);
+		f.planes[2] = row(3) + row(1);
+		f.planes[3] = row(3) - row(1);
+		f.planes[4] = row(3) + row(2);
+		f.planes[5] = row(3) - row(2);
+		for (auto &p : f.planes)
+			p /= glm::length(v3(p));
+		return f;
+	}
+
+	bool sphere(const v3 &center, float radius) const
+	{
+		for (const auto &p : planes)
+			if (glm::dot(v3(p), center) + p.w < -radius)
+				return false;
+		return true;
+	}
+};
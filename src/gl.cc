@@ -8,3 +8,11 @@ const unordered_map<int, string> GL::Shader::Types = {
 	{GL_GEOMETRY_SHADER, "GL_GEOMETRY_SHADER"},
 	{GL_FRAGMENT_SHADER, "GL_FRAGMENT_SHADER"},
 };
+
+GL::State& GL::State::current()
+{
+	// one GL context per thread: the window's on the main thread, the upload
+	// worker's on its own
+	static thread_local State state;
+	return state;
+}
@@ -4,9 +4,119 @@
 #include "types.hh"
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 struct GL
 {
+	// Shadow copy of the bindings and fixed-function state of the context
+	// current on this thread. Wrappers skip calls that would not change it.
+	struct State
+	{
+		static constexpr uint Unknown = ~0u;
+
+		struct Counters
+		{
+			uint issued{ 0 };
+			uint skipped{ 0 };
+		};
+
+		uint vertexArray{ Unknown };
+		uint program{ Unknown };
+		unordered_map<uint, uint> buffers;
+		// texture and sampler bound to each unit, grown on demand
+		vector<uint> textureUnits;
+		vector<uint> samplerUnits;
+		int viewport[4]{ -1, -1, -1, -1 };
+		int cullFace{ -1 };
+		uint cullMode{ Unknown };
+		uint frontFace{ Unknown };
+		int depthTest{ -1 };
+		int depthMask{ -1 };
+		uint depthFunc{ Unknown };
+		int blend{ -1 };
+		uint blendSrc{ Unknown };
+		uint blendDst{ Unknown };
+
+		Counters frame;
+		Counters last;
+		// compares the shadow state with glGet* on every skipped call
+		bool validate{ false };
+
+		static State& current();
+
+		// true when the call has to be issued
+		bool change(bool differs)
+		{
+			if (differs)
+				++frame.issued;
+			else
+				++frame.skipped;
+			return differs;
+		}
+
+		uint& buffer(uint target)
+		{
+			auto found = buffers.find(target);
+			if (found == end(buffers))
+				return buffers[target] = Unknown;
+			return found->second;
+		}
+
+		static uint& unit(vector<uint> &units, uint unit)
+		{
+			if (unit >= units.size())
+				units.resize(unit + 1, Unknown);
+			return units[unit];
+		}
+
+		// forget everything, after code that changes state behind our back
+		void invalidate()
+		{
+			auto keep = validate;
+			auto counters = frame;
+			auto lastCounters = last;
+			*this = State{};
+			validate = keep;
+			frame = counters;
+			last = lastCounters;
+		}
+
+		void endFrame()
+		{
+			last = frame;
+			frame = {};
+		}
+
+		void verify(uint pname, int expected, const char *what) const
+		{
+			if (!validate)
+				return;
+			int actual;
+			glGetIntegerv(pname, &actual);
+			if (actual != expected)
+				std::cerr << "gl.state: " << what << " shadow " << expected << " != actual " << actual << "\n";
+		}
+
+		static uint bindingOf(uint target)
+		{
+			switch (target)
+			{
+			case GL_ARRAY_BUFFER: return GL_ARRAY_BUFFER_BINDING;
+			case GL_ELEMENT_ARRAY_BUFFER: return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+			case GL_DRAW_INDIRECT_BUFFER: return GL_DRAW_INDIRECT_BUFFER_BINDING;
+			case GL_UNIFORM_BUFFER: return GL_UNIFORM_BUFFER_BINDING;
+			case GL_SHADER_STORAGE_BUFFER: return GL_SHADER_STORAGE_BUFFER_BINDING;
+			case GL_PIXEL_UNPACK_BUFFER: return GL_PIXEL_UNPACK_BUFFER_BINDING;
+			case GL_PIXEL_PACK_BUFFER: return GL_PIXEL_PACK_BUFFER_BINDING;
+			case GL_COPY_READ_BUFFER: return GL_COPY_READ_BUFFER_BINDING;
+			case GL_COPY_WRITE_BUFFER: return GL_COPY_WRITE_BUFFER_BINDING;
+			default: return 0;
+			}
+		}
+	};
+
 	struct M
 	{
 		mat4 fov(float degAngle, const Dimension &size, float zNear = 0.001f, float zFar = 1000.0f)
@@ -52,12 +162,25 @@ struct GL
 	{
 		void set(int x, int y, int w, int h)
 		{
-			glViewport(x, y, w, h);
+			auto &s = State::current();
+			auto &v = s.viewport;
+			if (s.change(v[0] != x || v[1] != y || v[2] != w || v[3] != h))
+			{
+				glViewport(x, y, w, h);
+				v[0] = x; v[1] = y; v[2] = w; v[3] = h;
+			}
+			else if (s.validate)
+			{
+				int actual[4];
+				glGetIntegerv(GL_VIEWPORT, actual);
+				if (actual[0] != x || actual[1] != y || actual[2] != w || actual[3] != h)
+					std::cerr << "gl.state: viewport shadow differs from actual\n";
+			}
 		}
 
 		void set(const Dimension &dim)
 		{
-			glViewport(0, 0, dim.w, dim.h);
+			set(0, 0, dim.w, dim.h);
 		}
 
 	} viewport;
@@ -127,11 +250,21 @@ struct GL
 		void del(uint program)
 		{
 			glDeleteProgram(program);
+			auto &s = State::current();
+			if (s.program == program)
+				s.program = State::Unknown;
 		}
 
 		void use(uint program)
 		{
-			glUseProgram(program);
+			auto &s = State::current();
+			if (s.change(s.program != program))
+			{
+				glUseProgram(program);
+				s.program = program;
+			}
+			else
+				s.verify(GL_CURRENT_PROGRAM, program, "program");
 		}
 
 		void link(uint program)
@@ -146,6 +279,68 @@ struct GL
 			return val;
 		}
 
+		uint blockIndex(uint program, const string &name)
+		{
+			return glGetUniformBlockIndex(program, name.c_str());
+		}
+
+		void blockBinding(uint program, uint index, uint binding)
+		{
+			glUniformBlockBinding(program, index, binding);
+		}
+
+		void parameter(uint program, uint pname, int value)
+		{
+			glProgramParameteri(program, pname, value);
+		}
+
+		// never blocks, true once compile and link have finished (KHR_parallel_shader_compile)
+		bool completed(uint program)
+		{
+			return getInt(program, GL_COMPLETION_STATUS_KHR) != 0;
+		}
+
+		void maxCompilerThreads(uint count)
+		{
+			glMaxShaderCompilerThreadsKHR(count);
+		}
+
+		vector<byte> binary(uint program, uint &format)
+		{
+			vector<byte> data(getInt(program, GL_PROGRAM_BINARY_LENGTH));
+			int len = 0;
+			if (!data.empty())
+				glGetProgramBinary(program, static_cast<int>(data.size()), &len, &format, data.data());
+			data.resize(len);
+			return data;
+		}
+
+		void binary(uint program, uint format, Span<byte> data)
+		{
+			glProgramBinary(program, format, data.data(), static_cast<int>(data.size()));
+		}
+
+		int interfaceInt(uint program, uint iface, uint pname)
+		{
+			int val = 0;
+			glGetProgramInterfaceiv(program, iface, pname, &val);
+			return val;
+		}
+
+		template <size_t N>
+		void resource(uint program, uint iface, uint index, const uint (&props)[N], int (&out)[N])
+		{
+			glGetProgramResourceiv(program, iface, index, N, props, N, nullptr, out);
+		}
+
+		string resourceName(uint program, uint iface, uint index, int bufSize)
+		{
+			vector<char> name(std::max(bufSize, 1));
+			int len = 0;
+			glGetProgramResourceName(program, iface, index, bufSize, &len, name.data());
+			return string(name.data(), len);
+		}
+
 		string infoLog(uint program, int bufSize)
 		{
 			vector<char> log;
@@ -165,15 +360,45 @@ struct GL
 			return glGetUniformLocation(program, name.c_str());
 		}
 
-		void set(uint loc, const v3 &v)
+		template <typename T>
+		void set(int loc, const T &v)
 		{
-			glUniform3fv(loc, 1, glm::value_ptr(v));
+			set(loc, &v, 1);
 		}
 
-		void set(uint loc, const mat4 &mat)
-		{
-			glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(mat));
-		}
+		void set(int loc, const float *v, int count) { glUniform1fv(loc, count, v); }
+		void set(int loc, const v2 *v, int count) { glUniform2fv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const v3 *v, int count) { glUniform3fv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const v4 *v, int count) { glUniform4fv(loc, count, glm::value_ptr(*v)); }
+
+		void set(int loc, const int *v, int count) { glUniform1iv(loc, count, v); }
+		void set(int loc, const iv2 *v, int count) { glUniform2iv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const iv3 *v, int count) { glUniform3iv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const iv4 *v, int count) { glUniform4iv(loc, count, glm::value_ptr(*v)); }
+
+		void set(int loc, const uint *v, int count) { glUniform1uiv(loc, count, v); }
+		void set(int loc, const uv2 *v, int count) { glUniform2uiv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const uv3 *v, int count) { glUniform3uiv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const uv4 *v, int count) { glUniform4uiv(loc, count, glm::value_ptr(*v)); }
+
+		void set(int loc, const double *v, int count) { glUniform1dv(loc, count, v); }
+		void set(int loc, const glm::dvec2 *v, int count) { glUniform2dv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const glm::dvec3 *v, int count) { glUniform3dv(loc, count, glm::value_ptr(*v)); }
+		void set(int loc, const glm::dvec4 *v, int count) { glUniform4dv(loc, count, glm::value_ptr(*v)); }
+
+		void set(int loc, const mat2 *m, int count) { glUniformMatrix2fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const mat3 *m, int count) { glUniformMatrix3fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const mat4 *m, int count) { glUniformMatrix4fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::mat2x3 *m, int count) { glUniformMatrix2x3fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::mat3x2 *m, int count) { glUniformMatrix3x2fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::mat2x4 *m, int count) { glUniformMatrix2x4fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::mat4x2 *m, int count) { glUniformMatrix4x2fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::mat3x4 *m, int count) { glUniformMatrix3x4fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::mat4x3 *m, int count) { glUniformMatrix4x3fv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+
+		void set(int loc, const glm::dmat2 *m, int count) { glUniformMatrix2dv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::dmat3 *m, int count) { glUniformMatrix3dv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
+		void set(int loc, const glm::dmat4 *m, int count) { glUniformMatrix4dv(loc, count, GL_FALSE, glm::value_ptr(*m)); }
 
 	} uniform;
 
@@ -188,12 +413,68 @@ struct GL
 
 		void bind(uint va)
 		{
-			glBindVertexArray(va);
+			auto &s = State::current();
+			if (s.change(s.vertexArray != va))
+			{
+				glBindVertexArray(va);
+				s.vertexArray = va;
+				// the element buffer binding belongs to the VAO
+				s.buffer(GL_ELEMENT_ARRAY_BUFFER) = State::Unknown;
+			}
+			else
+				s.verify(GL_VERTEX_ARRAY_BINDING, va, "vertex array");
 		}
 
 		void del(uint va)
 		{
 			glDeleteVertexArrays(1, &va);
+			auto &s = State::current();
+			if (s.vertexArray == va)
+			{
+				s.vertexArray = 0;
+				s.buffer(GL_ELEMENT_ARRAY_BUFFER) = State::Unknown;
+			}
+		}
+
+		void enableAttrib(uint va, uint index)
+		{
+			glEnableVertexArrayAttrib(va, index);
+		}
+
+		void disableAttrib(uint va, uint index)
+		{
+			glDisableVertexArrayAttrib(va, index);
+		}
+
+		void attribFormat(uint va, uint index, int size, uint type, bool normalized, uint relativeOffset)
+		{
+			glVertexArrayAttribFormat(va, index, size, type, normalized, relativeOffset);
+		}
+
+		void attribIFormat(uint va, uint index, int size, uint type, uint relativeOffset)
+		{
+			glVertexArrayAttribIFormat(va, index, size, type, relativeOffset);
+		}
+
+		void attribBinding(uint va, uint index, uint binding)
+		{
+			glVertexArrayAttribBinding(va, index, binding);
+		}
+
+		void vertexBuffer(uint va, uint binding, uint buf, size_t offset, int stride)
+		{
+			glVertexArrayVertexBuffer(va, binding, buf, offset, stride);
+		}
+
+		void elementBuffer(uint va, uint buf)
+		{
+			glVertexArrayElementBuffer(va, buf);
+		}
+
+		// per-instance attributes: advance once every `divisor` instances
+		void bindingDivisor(uint va, uint binding, uint divisor)
+		{
+			glVertexArrayBindingDivisor(va, binding, divisor);
 		}
 	} vertexArray;
 
@@ -229,24 +510,134 @@ struct GL
 			return buf;
 		}
 
+		uint create()
+		{
+			uint buf;
+			glCreateBuffers(1, &buf);
+			return buf;
+		}
+
+		void storage(uint buf, size_t size, const void *data, uint flags)
+		{
+			glNamedBufferStorage(buf, size, data, flags);
+		}
+
+		void* mapRange(uint buf, size_t offset, size_t length, uint access)
+		{
+			return glMapNamedBufferRange(buf, offset, length, access);
+		}
+
+		void unmap(uint buf)
+		{
+			glUnmapNamedBuffer(buf);
+		}
+
+		void subData(uint buf, size_t offset, size_t size, const void *data)
+		{
+			glNamedBufferSubData(buf, offset, size, data);
+		}
+
+		void copy(uint src, uint dst, size_t srcOffset, size_t dstOffset, size_t size)
+		{
+			glCopyNamedBufferSubData(src, dst, srcOffset, dstOffset, size);
+		}
+
 		void del(uint buf)
 		{
 			glDeleteBuffers(1, &buf);
+			for (auto &b : State::current().buffers)
+				if (b.second == buf)
+					b.second = 0;
 		}
 
 		void bind(uint target, uint buf)
 		{
-			glBindBuffer(target, buf);
+			auto &s = State::current();
+			auto &bound = s.buffer(target);
+			if (s.change(bound != buf))
+			{
+				glBindBuffer(target, buf);
+				bound = buf;
+			}
+			else if (auto pname = State::bindingOf(target))
+				s.verify(pname, buf, "buffer binding");
+		}
+
+		// indexed targets: GL_SHADER_STORAGE_BUFFER, GL_UNIFORM_BUFFER, ...
+		void bindBase(uint target, uint index, uint buf)
+		{
+			glBindBufferBase(target, index, buf);
+		}
+
+		// offset must respect GL_*_BUFFER_OFFSET_ALIGNMENT of the target
+		void bindRange(uint target, uint index, uint buf, size_t offset, size_t size)
+		{
+			glBindBufferRange(target, index, buf, offset, size);
+		}
+
+		template <typename Range>
+		void data(uint target, const Range &r, uint usage = GL_STATIC_DRAW)
+		{
+			auto s = span(r);
+			glBufferData(target, s.bytes(), s.data(), usage);
+		}
+
+		template <typename Range>
+		void namedData(uint buf, const Range &r, uint usage = GL_STATIC_DRAW)
+		{
+			auto s = span(r);
+			glNamedBufferData(buf, s.bytes(), s.data(), usage);
+		}
+
+		// interleaved vertices described by a VertexLayout
+		template <typename Layout, typename V>
+		void data(uint buf, const vector<V> &vv, uint usage = GL_STATIC_DRAW)
+		{
+			static_assert(Layout::template matches<V>, "vertex type does not match layout");
+			namedData(buf, vv, usage);
 		}
 
-		void data(uint target, const vector<v3> &vv, uint usage = GL_STATIC_DRAW)
+		// updates elements [first, first + r.size()) in place
+		template <typename Range>
+		void subData(uint buf, size_t first, const Range &r)
 		{
-			glBufferData(target, sizeof(v3) * vv.size(), &vv[0], usage);
+			auto s = span(r);
+			glNamedBufferSubData(buf, sizeof(*s.data()) * first, s.bytes(), s.data());
 		}
 
-		void data(uint target, const vector<u32> &vv, uint usage = GL_STATIC_DRAW)
+		// write-discard: detaches the old store so in-flight draws keep reading it
+		void orphan(uint buf, size_t size, uint usage = GL_STREAM_DRAW)
 		{
-			glBufferData(target, sizeof(u32) * vv.size(), &vv[0], usage);
+			glNamedBufferData(buf, size, nullptr, usage);
+		}
+
+		// write-discard for immutable (glBufferStorage) buffers
+		void invalidate(uint buf)
+		{
+			glInvalidateBufferData(buf);
+		}
+
+		// maps only the written range without waiting on the GPU, caller
+		// guarantees the range is not read by commands still in flight
+		template <typename Range>
+		bool writeUnsynchronized(uint buf, size_t first, const Range &r)
+		{
+			auto s = span(r);
+			auto offset = sizeof(*s.data()) * first;
+			auto ptr = glMapNamedBufferRange(buf, offset, s.bytes(),
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (!ptr)
+				return false;
+			std::memcpy(ptr, s.data(), s.bytes());
+			return glUnmapNamedBuffer(buf);
+		}
+
+		template <typename Range>
+		static auto span(const Range &r)
+		{
+			using T = std::remove_const_t<std::remove_pointer_t<decltype(std::data(r))>>;
+			static_assert(std::is_trivially_copyable_v<T>, "buffer uploads need trivially copyable elements");
+			return Span<T>(r);
 		}
 
 		// array
@@ -254,12 +645,26 @@ struct GL
 		{
 			void bind(uint buf)
 			{
-				glBindBuffer(GL_ARRAY_BUFFER, buf);
+				Buffer().bind(GL_ARRAY_BUFFER, buf);
 			}
 
-			void data(const vector<v3> &vv, uint usage = GL_STATIC_DRAW)
+			template <typename Range>
+			void data(const Range &r, uint usage = GL_STATIC_DRAW)
 			{
-				glBufferData(GL_ARRAY_BUFFER, sizeof(v3) * vv.size(), &vv[0], usage);
+				auto s = span(r);
+				glBufferData(GL_ARRAY_BUFFER, s.bytes(), s.data(), usage);
+			}
+
+			template <typename Range>
+			void subData(size_t first, const Range &r)
+			{
+				auto s = span(r);
+				glBufferSubData(GL_ARRAY_BUFFER, sizeof(*s.data()) * first, s.bytes(), s.data());
+			}
+
+			void orphan(size_t size, uint usage = GL_STREAM_DRAW)
+			{
+				glBufferData(GL_ARRAY_BUFFER, size, nullptr, usage);
 			}
 		} array;
 
@@ -268,16 +673,202 @@ struct GL
 		{
 			void bind(uint buf)
 			{
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buf);
+				Buffer().bind(GL_ELEMENT_ARRAY_BUFFER, buf);
+			}
+
+			template <typename Range>
+			void data(const Range &r, uint usage = GL_STATIC_DRAW)
+			{
+				auto s = span(r);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, s.bytes(), s.data(), usage);
+			}
+
+			template <typename Range>
+			void subData(size_t first, const Range &r)
+			{
+				auto s = span(r);
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(*s.data()) * first, s.bytes(), s.data());
 			}
 
-			void data(const vector<u32> &ii, uint usage = GL_STATIC_DRAW)
+			void orphan(size_t size, uint usage = GL_STREAM_DRAW)
 			{
-				glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u32) * ii.size(), &ii[0], usage);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, nullptr, usage);
 			}
 		} element;
 	} buffer;
 
+	struct Query
+	{
+		uint create(uint target)
+		{
+			uint q;
+			glCreateQueries(target, 1, &q);
+			return q;
+		}
+
+		void del(uint q)
+		{
+			glDeleteQueries(1, &q);
+		}
+
+		void begin(uint target, uint q)
+		{
+			glBeginQuery(target, q);
+		}
+
+		void end(uint target)
+		{
+			glEndQuery(target);
+		}
+
+		bool available(uint q)
+		{
+			int val;
+			glGetQueryObjectiv(q, GL_QUERY_RESULT_AVAILABLE, &val);
+			return val;
+		}
+
+		u64 result(uint q)
+		{
+			GLuint64 val;
+			glGetQueryObjectui64v(q, GL_QUERY_RESULT, &val);
+			return val;
+		}
+	} query;
+
+	struct Sync
+	{
+		GLsync fence()
+		{
+			return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+
+		uint clientWait(GLsync sync, u64 timeout)
+		{
+			return glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		}
+
+		void del(GLsync sync)
+		{
+			glDeleteSync(sync);
+		}
+	} sync;
+
+	struct Texture
+	{
+		uint create(uint target)
+		{
+			uint tex;
+			glCreateTextures(target, 1, &tex);
+			return tex;
+		}
+
+		void del(uint tex)
+		{
+			glDeleteTextures(1, &tex);
+			// deleting unbinds the texture from every unit
+			for (auto &bound : State::current().textureUnits)
+				if (bound == tex)
+					bound = 0;
+		}
+
+		// immutable storage, levels can only be filled afterwards
+		void storage2D(uint tex, int levels, uint internalFormat, int w, int h)
+		{
+			glTextureStorage2D(tex, levels, internalFormat, w, h);
+		}
+
+		void storage3D(uint tex, int levels, uint internalFormat, int w, int h, int d)
+		{
+			glTextureStorage3D(tex, levels, internalFormat, w, h, d);
+		}
+
+		// with a GL_PIXEL_UNPACK_BUFFER bound, pixels is a byte offset into it
+		void subImage2D(uint tex, int level, int x, int y, int w, int h, uint format, uint type, const void *pixels)
+		{
+			glTextureSubImage2D(tex, level, x, y, w, h, format, type, pixels);
+		}
+
+		void subImage3D(uint tex, int level, int x, int y, int z, int w, int h, int d, uint format, uint type, const void *pixels)
+		{
+			glTextureSubImage3D(tex, level, x, y, z, w, h, d, format, type, pixels);
+		}
+
+		void generateMipmap(uint tex)
+		{
+			glGenerateTextureMipmap(tex);
+		}
+
+		void parameter(uint tex, uint pname, int value)
+		{
+			glTextureParameteri(tex, pname, value);
+		}
+
+		void bindUnit(uint unit, uint tex)
+		{
+			auto &s = State::current();
+			auto &bound = State::unit(s.textureUnits, unit);
+			if (s.change(bound != tex))
+			{
+				glBindTextureUnit(unit, tex);
+				bound = tex;
+			}
+		}
+
+		void unpackAlignment(int alignment)
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+		}
+
+		// full mip chain down to 1x1
+		static int levels(int w, int h)
+		{
+			int n = 1;
+			for (int size = std::max(w, h); size > 1; size /= 2)
+				++n;
+			return n;
+		}
+	} texture;
+
+	struct Sampler
+	{
+		uint create()
+		{
+			uint sampler;
+			glCreateSamplers(1, &sampler);
+			return sampler;
+		}
+
+		void del(uint sampler)
+		{
+			glDeleteSamplers(1, &sampler);
+			for (auto &bound : State::current().samplerUnits)
+				if (bound == sampler)
+					bound = 0;
+		}
+
+		void parameter(uint sampler, uint pname, int value)
+		{
+			glSamplerParameteri(sampler, pname, value);
+		}
+
+		void parameter(uint sampler, uint pname, float value)
+		{
+			glSamplerParameterf(sampler, pname, value);
+		}
+
+		void bind(uint unit, uint sampler)
+		{
+			auto &s = State::current();
+			auto &bound = State::unit(s.samplerUnits, unit);
+			if (s.change(bound != sampler))
+			{
+				glBindSampler(unit, sampler);
+				bound = sampler;
+			}
+		}
+	} sampler;
+
 	struct Draw
 	{
 		void arrays(uint mode, int offset, int count)
@@ -285,14 +876,48 @@ struct GL
 			glDrawArrays(mode, offset, count);
 		}
 
-		void elements(uint mode, int count)
+		void elements(uint mode, int count, uint type = GL_UNSIGNED_INT, size_t indexOffset = 0)
 		{
-			glDrawElements(mode, sizeof(u32) * count, GL_UNSIGNED_INT, nullptr);
+			glDrawElements(mode, count, type, reinterpret_cast<void *>(indexOffset));
 		}
 
-		void elementsBaseVertex(uint mode, int count, int offset = 0)
+		void elementsBaseVertex(uint mode, int count, int baseVertex = 0, size_t indexOffset = 0, uint type = GL_UNSIGNED_INT)
 		{
-			glDrawElementsBaseVertex(mode, sizeof(u32) * count, GL_UNSIGNED_INT, nullptr, offset);
+			glDrawElementsBaseVertex(mode, count, type, reinterpret_cast<void *>(indexOffset), baseVertex);
+		}
+
+		// start/end bound the index values (before baseVertex is added)
+		void rangeElements(uint mode, uint start, uint end, int count, uint type = GL_UNSIGNED_INT, size_t indexOffset = 0)
+		{
+			glDrawRangeElements(mode, start, end, count, type, reinterpret_cast<void *>(indexOffset));
+		}
+
+		void rangeElementsBaseVertex(uint mode, uint start, uint end, int count, int baseVertex, size_t indexOffset = 0, uint type = GL_UNSIGNED_INT)
+		{
+			glDrawRangeElementsBaseVertex(mode, start, end, count, type, reinterpret_cast<void *>(indexOffset), baseVertex);
+		}
+
+		void elementsInstanced(uint mode, int count, int instances, uint type = GL_UNSIGNED_INT, size_t indexOffset = 0)
+		{
+			glDrawElementsInstanced(mode, count, type, reinterpret_cast<void *>(indexOffset), instances);
+		}
+
+		// baseInstance offsets instanced attributes only, gl_InstanceID still starts at 0
+		void elementsInstancedBaseVertexBaseInstance(uint mode, int count, int instances, int baseVertex, uint baseInstance,
+			size_t indexOffset = 0, uint type = GL_UNSIGNED_INT)
+		{
+			glDrawElementsInstancedBaseVertexBaseInstance(mode, count, type, reinterpret_cast<void *>(indexOffset), instances, baseVertex, baseInstance);
+		}
+
+		// offset is a byte offset into the bound GL_DRAW_INDIRECT_BUFFER
+		void elementsIndirect(uint mode, size_t offset = 0, uint type = GL_UNSIGNED_INT)
+		{
+			glDrawElementsIndirect(mode, type, reinterpret_cast<void *>(offset));
+		}
+
+		void multiElementsIndirect(uint mode, int drawCount, size_t offset = 0, uint type = GL_UNSIGNED_INT, int stride = 0)
+		{
+			glMultiDrawElementsIndirect(mode, type, reinterpret_cast<void *>(offset), drawCount, stride);
 		}
 
 		// custom
@@ -303,14 +928,14 @@ struct GL
 				glDrawArrays(GL_TRIANGLES, offset, count);
 			}
 
-			void elements(int count)
+			void elements(int count, uint type = GL_UNSIGNED_INT, size_t indexOffset = 0)
 			{
-				glDrawElements(GL_TRIANGLES, sizeof(u32) * count, GL_UNSIGNED_INT, nullptr);
+				glDrawElements(GL_TRIANGLES, count, type, reinterpret_cast<void *>(indexOffset));
 			}
 
-			void elementsBaseVertex(int count, int offset = 0)
+			void elementsBaseVertex(int count, int baseVertex = 0, size_t indexOffset = 0, uint type = GL_UNSIGNED_INT)
 			{
-				glDrawElementsBaseVertex(GL_TRIANGLES, sizeof(u32) * count, GL_UNSIGNED_INT, nullptr, offset);
+				glDrawElementsBaseVertex(GL_TRIANGLES, count, type, reinterpret_cast<void *>(indexOffset), baseVertex);
 			}
 		} triangles;
 	} draw;
@@ -319,32 +944,183 @@ struct GL
 	{
 		void enable(bool val = true)
 		{
-			if (val)
-				glEnable(GL_CULL_FACE);
+			auto &s = State::current();
+			if (s.change(s.cullFace != int(val)))
+			{
+				if (val)
+					glEnable(GL_CULL_FACE);
+				else
+					glDisable(GL_CULL_FACE);
+				s.cullFace = val;
+			}
 			else
-				glDisable(GL_CULL_FACE);
+				s.verify(GL_CULL_FACE, val, "cull face");
 		}
 
 		void back()
 		{
-			glCullFace(GL_BACK);
+			mode(GL_BACK);
 		}
 
 		void front()
 		{
-			glCullFace(GL_FRONT);
+			mode(GL_FRONT);
 		}
 
 		void ccwFront()
 		{
-			glFrontFace(GL_CCW);
+			frontFace(GL_CCW);
 		}
 
 		void cwFront()
 		{
-			glFrontFace(GL_CW);
+			frontFace(GL_CW);
+		}
+
+	private:
+		void mode(uint face)
+		{
+			auto &s = State::current();
+			if (s.change(s.cullMode != face))
+			{
+				glCullFace(face);
+				s.cullMode = face;
+			}
+			else
+				s.verify(GL_CULL_FACE_MODE, face, "cull face mode");
+		}
+
+		void frontFace(uint dir)
+		{
+			auto &s = State::current();
+			if (s.change(s.frontFace != dir))
+			{
+				glFrontFace(dir);
+				s.frontFace = dir;
+			}
+			else
+				s.verify(GL_FRONT_FACE, dir, "front face");
 		}
 	} cullFace;
+
+	struct Depth
+	{
+		void test(bool val = true)
+		{
+			auto &s = State::current();
+			if (s.change(s.depthTest != int(val)))
+			{
+				if (val)
+					glEnable(GL_DEPTH_TEST);
+				else
+					glDisable(GL_DEPTH_TEST);
+				s.depthTest = val;
+			}
+			else
+				s.verify(GL_DEPTH_TEST, val, "depth test");
+		}
+
+		void mask(bool write)
+		{
+			auto &s = State::current();
+			if (s.change(s.depthMask != int(write)))
+			{
+				glDepthMask(write);
+				s.depthMask = write;
+			}
+			else
+				s.verify(GL_DEPTH_WRITEMASK, write, "depth mask");
+		}
+
+		void func(uint fn)
+		{
+			auto &s = State::current();
+			if (s.change(s.depthFunc != fn))
+			{
+				glDepthFunc(fn);
+				s.depthFunc = fn;
+			}
+			else
+				s.verify(GL_DEPTH_FUNC, fn, "depth func");
+		}
+	} depth;
+
+	struct Blend
+	{
+		void enable(bool val = true)
+		{
+			auto &s = State::current();
+			if (s.change(s.blend != int(val)))
+			{
+				if (val)
+					glEnable(GL_BLEND);
+				else
+					glDisable(GL_BLEND);
+				s.blend = val;
+			}
+			else
+				s.verify(GL_BLEND, val, "blend");
+		}
+
+		void func(uint src, uint dst)
+		{
+			auto &s = State::current();
+			if (s.change(s.blendSrc != src || s.blendDst != dst))
+			{
+				glBlendFunc(src, dst);
+				s.blendSrc = src;
+				s.blendDst = dst;
+			}
+			else
+			{
+				s.verify(GL_BLEND_SRC_RGB, src, "blend src");
+				s.verify(GL_BLEND_DST_RGB, dst, "blend dst");
+			}
+		}
+
+		void alpha()
+		{
+			func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		}
+	} blend;
+
+	State& state()
+	{
+		return State::current();
+	}
+};
+
+// layout consumed by glDrawElementsIndirect/glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	u32 count;
+	u32 instanceCount;
+	u32 firstIndex;
+	i32 baseVertex;
+	u32 baseInstance;
+};
+
+// Element range touched since the last upload, so only the dirty part of a
+// CPU-side copy is sent with Buffer::subData.
+struct DirtyRange
+{
+	size_t first{ ~size_t(0) };
+	size_t last{ 0 };
+
+	void mark(size_t i) { mark(i, 1); }
+	void mark(size_t i, size_t count)
+	{
+		first = std::min(first, i);
+		last = std::max(last, i + count);
+	}
+	bool empty() const { return first >= last; }
+	void reset() { *this = DirtyRange{}; }
+
+	template <typename T>
+	Span<T> of(const vector<T> &vv) const
+	{
+		return empty() ? Span<T>() : Span<T>(vv).sub(first, last - first);
+	}
 };
 
 struct Bytes
@@ -28,6 +28,11 @@ struct GLFW
 			glfwWindowHint(GLFW_RESIZABLE, static_cast<int>(resizable));
 		}
 
+		void hintVisible(bool visible)
+		{
+			glfwWindowHint(GLFW_VISIBLE, static_cast<int>(visible));
+		}
+
 		bool shouldClose(GLFWwindow *wnd) const
 		{
 			return glfwWindowShouldClose(wnd);
@@ -48,9 +53,9 @@ struct GLFW
 			glfwSwapBuffers(wnd);
 		}
 
-		GLFWwindow* create(int w, int h, string title)
+		GLFWwindow* create(int w, int h, string title, GLFWwindow *share = nullptr)
 		{
-			return glfwCreateWindow(w, h, title.c_str(), nullptr, nullptr);
+			return glfwCreateWindow(w, h, title.c_str(), nullptr, share);
 		}
 
 		void destroy(GLFWwindow *wnd)
@@ -0,0 +1,514 @@
+#include "image.hh"
+#include "files.hh"
+#include "gl.hh"
+#include "inflate.hh"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	u32 be32(const byte *p)
+	{
+		return (u32(p[0]) << 24) | (u32(p[1]) << 16) | (u32(p[2]) << 8) | u32(p[3]);
+	}
+
+	u16 le16(const byte *p)
+	{
+		return static_cast<u16>(p[0] | (p[1] << 8));
+	}
+
+	Image fail(const char *format, const char *why)
+	{
+		std::cerr << format << ": " << why << "\n";
+		return {};
+	}
+
+	void flipRows(Image &img)
+	{
+		size_t row = img.pixelBytes() * img.width;
+		vector<byte> tmp(row);
+		for (int y = 0; y < img.height / 2; ++y)
+		{
+			auto a = img.pixels.data() + row * y;
+			auto b = img.pixels.data() + row * (img.height - 1 - y);
+			std::memcpy(tmp.data(), a, row);
+			std::memcpy(a, b, row);
+			std::memcpy(b, tmp.data(), row);
+		}
+	}
+
+	u8 paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return static_cast<u8>(a);
+		return static_cast<u8>(pb <= pc ? b : c);
+	}
+
+	float toLinear(u8 v)
+	{
+		static const auto table = [] {
+			std::array<float, 256> t{};
+			for (int i = 0; i < 256; ++i)
+			{
+				float c = i / 255.0f;
+				t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return t;
+		}();
+		return table[v];
+	}
+
+	u8 toSrgb(float v)
+	{
+		static const auto table = [] {
+			std::array<u8, 4096> t{};
+			for (int i = 0; i < 4096; ++i)
+			{
+				float c = i / 4095.0f;
+				c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+				t[i] = static_cast<u8>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+			}
+			return t;
+		}();
+		return table[static_cast<size_t>(std::clamp(v, 0.0f, 1.0f) * 4095.0f + 0.5f)];
+	}
+}
+
+uint Image::internalFormat(bool srgb) const
+{
+	if (hdr)
+		return GL_RGB16F;
+	switch (channels)
+	{
+	case 1: return GL_R8;
+	case 2: return GL_RG8;
+	case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+	default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+}
+
+uint Image::format() const
+{
+	switch (channels)
+	{
+	case 1: return GL_RED;
+	case 2: return GL_RG;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+uint Image::type() const
+{
+	return hdr ? GL_FLOAT : GL_UNSIGNED_BYTE;
+}
+
+Image Images::load(const string &path)
+{
+	vector<byte> data;
+	if (!Files::readBinary(path, data))
+		return fail("image", ("cannot read " + path).c_str());
+
+	auto img = decode(data);
+	if (!img.valid())
+		std::cerr << "image: failed to decode " << path << "\n";
+	return img;
+}
+
+Image Images::decode(Span<byte> data)
+{
+	static const byte pngSignature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if (data.size() >= 8 && std::memcmp(data.data(), pngSignature, 8) == 0)
+		return png(data);
+	if (data.size() >= 2 && data.data()[0] == '#' && data.data()[1] == '?')
+		return hdr(data);
+	// TGA has no magic number
+	return tga(data);
+}
+
+Image Images::tga(Span<byte> data)
+{
+	const byte *p = data.data();
+	if (data.size() < 18)
+		return fail("tga", "truncated header");
+
+	int idLength = p[0];
+	int colorMapType = p[1];
+	int imageType = p[2];
+	int width = le16(p + 12);
+	int height = le16(p + 14);
+	int bpp = p[16];
+	int descriptor = p[17];
+
+	bool rle = imageType == 10 || imageType == 11;
+	bool gray = imageType == 3 || imageType == 11;
+	if (colorMapType != 0 || !(imageType == 2 || imageType == 3 || rle))
+		return fail("tga", "only true color and grayscale images are supported");
+	if (gray ? bpp != 8 : (bpp != 24 && bpp != 32))
+		return fail("tga", "unsupported bit depth");
+
+	Image img;
+	img.width = width;
+	img.height = height;
+	img.channels = bpp / 8;
+	img.pixels.resize(img.bytes());
+
+	size_t pos = 18 + idLength;
+	size_t pixel = img.channels;
+	size_t total = size_t(width) * height;
+	auto out = img.pixels.data();
+
+	auto read = [&](byte *dst) {
+		if (pos + pixel > data.size())
+			return false;
+		std::memcpy(dst, p + pos, pixel);
+		pos += pixel;
+		return true;
+	};
+
+	for (size_t i = 0; i < total;)
+	{
+		size_t run = 1;
+		bool repeat = false;
+		if (rle)
+		{
+			if (pos >= data.size())
+				return fail("tga", "truncated data");
+			byte header = p[pos++];
+			run = (header & 0x7F) + 1;
+			repeat = (header & 0x80) != 0;
+		}
+		if (i + run > total)
+			return fail("tga", "run crosses the end of the image");
+
+		for (size_t r = 0; r < run; ++r, ++i)
+		{
+			auto dst = out + i * pixel;
+			if (repeat && r > 0)
+				std::memcpy(dst, dst - pixel, pixel);
+			else if (!read(dst))
+				return fail("tga", "truncated data");
+		}
+	}
+
+	// BGR(A) to RGB(A)
+	if (!gray)
+		for (size_t i = 0; i < total; ++i)
+			std::swap(out[i * pixel], out[i * pixel + 2]);
+
+	// bottom-left origin unless the descriptor says top-left
+	if ((descriptor & 0x20) == 0)
+		flipRows(img);
+
+	return img;
+}
+
+Image Images::png(Span<byte> data)
+{
+	const byte *p = data.data();
+	size_t pos = 8;
+
+	u32 width = 0, height = 0;
+	int depth = 0, colorType = 0, interlace = 0;
+	vector<byte> idat;
+	vector<byte> palette;
+	vector<byte> paletteAlpha;
+
+	while (pos + 12 <= data.size())
+	{
+		u32 len = be32(p + pos);
+		const byte *type = p + pos + 4;
+		const byte *chunk = p + pos + 8;
+		if (pos + 12 + size_t(len) > data.size())
+			return fail("png", "truncated chunk");
+
+		if (std::memcmp(type, "IHDR", 4) == 0 && len >= 13)
+		{
+			width = be32(chunk);
+			height = be32(chunk + 4);
+			depth = chunk[8];
+			colorType = chunk[9];
+			interlace = chunk[12];
+		}
+		else if (std::memcmp(type, "PLTE", 4) == 0)
+			palette.assign(chunk, chunk + len);
+		else if (std::memcmp(type, "tRNS", 4) == 0)
+			paletteAlpha.assign(chunk, chunk + len);
+		else if (std::memcmp(type, "IDAT", 4) == 0)
+			idat.insert(end(idat), chunk, chunk + len);
+		else if (std::memcmp(type, "IEND", 4) == 0)
+			break;
+
+		pos += 12 + len;
+	}
+
+	int samples = 0;
+	switch (colorType)
+	{
+	case 0: samples = 1; break;
+	case 2: samples = 3; break;
+	case 3: samples = 1; break;
+	case 4: samples = 2; break;
+	case 6: samples = 4; break;
+	default: return fail("png", "unknown color type");
+	}
+	if (width == 0 || height == 0 || width > 0x8000 || height > 0x8000)
+		return fail("png", "bad dimensions");
+	if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16)
+		return fail("png", "bad bit depth");
+	if (interlace != 0)
+		return fail("png", "interlaced images are not supported");
+	if (colorType == 3 && palette.empty())
+		return fail("png", "missing palette");
+
+	size_t bitsPerPixel = size_t(samples) * depth;
+	size_t stride = (width * bitsPerPixel + 7) / 8;
+	size_t filterBpp = std::max<size_t>(1, bitsPerPixel / 8);
+	size_t expected = height * (stride + 1);
+	// no deflate stream this short can expand to the size the header claims
+	if (expected / Inflate::MaxRatio > idat.size())
+		return fail("png", "image data too short");
+
+	vector<byte> raw;
+	raw.reserve(expected);
+	if (!Inflate::zlib(idat, raw, expected))
+		return fail("png", "bad image data");
+	if (raw.size() < expected)
+		return fail("png", "image data too short");
+
+	// undo the per row filters in place, row y starts after its filter byte
+	for (u32 y = 0; y < height; ++y)
+	{
+		byte *row = raw.data() + y * (stride + 1);
+		byte filter = row[0];
+		byte *cur = row + 1;
+		const byte *prev = y > 0 ? raw.data() + (y - 1) * (stride + 1) + 1 : nullptr;
+
+		for (size_t x = 0; x < stride; ++x)
+		{
+			int a = x >= filterBpp ? cur[x - filterBpp] : 0;
+			int b = prev ? prev[x] : 0;
+			int c = prev && x >= filterBpp ? prev[x - filterBpp] : 0;
+			switch (filter)
+			{
+			case 0: break;
+			case 1: cur[x] = static_cast<byte>(cur[x] + a); break;
+			case 2: cur[x] = static_cast<byte>(cur[x] + b); break;
+			case 3: cur[x] = static_cast<byte>(cur[x] + (a + b) / 2); break;
+			case 4: cur[x] = static_cast<byte>(cur[x] + paeth(a, b, c)); break;
+			default: return fail("png", "bad filter type");
+			}
+		}
+	}
+
+	Image img;
+	img.width = static_cast<int>(width);
+	img.height = static_cast<int>(height);
+	img.channels = colorType == 3 ? (paletteAlpha.empty() ? 3 : 4) : samples;
+	img.pixels.resize(img.bytes());
+
+	int maxValue = (1 << depth) - 1;
+	for (u32 y = 0; y < height; ++y)
+	{
+		const byte *row = raw.data() + y * (stride + 1) + 1;
+		byte *out = img.pixels.data() + size_t(y) * width * img.channels;
+
+		for (u32 x = 0; x < width; ++x)
+		{
+			for (int s = 0; s < samples; ++s)
+			{
+				size_t i = size_t(x) * samples + s;
+				int v;
+				if (depth == 8)
+					v = row[i];
+				else if (depth == 16)
+					v = row[i * 2];
+				else
+				{
+					size_t bit = i * depth;
+					v = (row[bit / 8] >> (8 - depth - bit % 8)) & maxValue;
+				}
+
+				if (colorType == 3)
+				{
+					if (size_t(v) * 3 + 2 >= palette.size())
+						return fail("png", "palette index out of range");
+					auto dst = out + size_t(x) * img.channels;
+					std::memcpy(dst, palette.data() + v * 3, 3);
+					if (img.channels == 4)
+						dst[3] = size_t(v) < paletteAlpha.size() ? paletteAlpha[v] : 255;
+				}
+				else
+				{
+					if (depth < 8)
+						v = v * 255 / maxValue;
+					out[i] = static_cast<byte>(v);
+				}
+			}
+		}
+	}
+
+	return img;
+}
+
+Image Images::hdr(Span<byte> data)
+{
+	const char *p = reinterpret_cast<const char *>(data.data());
+	size_t size = data.size();
+	size_t pos = 0;
+
+	auto line = [&]() {
+		string s;
+		while (pos < size && p[pos] != '\n')
+			s += p[pos++];
+		++pos;
+		return s;
+	};
+
+	auto magic = line();
+	if (magic != "#?RADIANCE" && magic != "#?RGBE")
+		return fail("hdr", "missing radiance header");
+
+	for (string l = line(); !l.empty(); l = line())
+	{
+		if (l.rfind("FORMAT=", 0) == 0 && l != "FORMAT=32-bit_rle_rgbe")
+			return fail("hdr", "only rgbe data is supported");
+		if (pos >= size)
+			return fail("hdr", "truncated header");
+	}
+
+	int width = 0, height = 0;
+	if (std::sscanf(line().c_str(), "-Y %d +X %d", &height, &width) != 2 || width <= 0 || height <= 0)
+		return fail("hdr", "only -Y h +X w orientation is supported");
+
+	Image img;
+	img.width = width;
+	img.height = height;
+	img.channels = 3;
+	img.hdr = true;
+	img.pixels.resize(img.bytes());
+	auto out = reinterpret_cast<float *>(img.pixels.data());
+
+	auto bytes = reinterpret_cast<const byte *>(p);
+	vector<byte> scanline(size_t(width) * 4);
+
+	for (int y = 0; y < height; ++y)
+	{
+		bool newRle = width >= 8 && width < 0x8000 && pos + 4 <= size &&
+			bytes[pos] == 2 && bytes[pos + 1] == 2 && ((bytes[pos + 2] << 8) | bytes[pos + 3]) == width;
+
+		if (newRle)
+		{
+			pos += 4;
+			// components are stored one after the other, each run length encoded
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int x = 0; x < width;)
+				{
+					if (pos >= size)
+						return fail("hdr", "truncated data");
+					int count = bytes[pos++];
+					bool run = count > 128;
+					if (run)
+						count -= 128;
+					if (count == 0 || x + count > width || pos + (run ? 1 : count) > size)
+						return fail("hdr", "bad scanline");
+					for (int i = 0; i < count; ++i, ++x)
+						scanline[x * 4 + c] = run ? bytes[pos] : bytes[pos + i];
+					pos += run ? 1 : count;
+				}
+			}
+		}
+		else
+		{
+			if (pos + scanline.size() > size)
+				return fail("hdr", "truncated data");
+			std::memcpy(scanline.data(), bytes + pos, scanline.size());
+			pos += scanline.size();
+		}
+
+		for (int x = 0; x < width; ++x)
+		{
+			const byte *rgbe = scanline.data() + x * 4;
+			float *dst = out + (size_t(y) * width + x) * 3;
+			float f = rgbe[3] ? std::ldexp(1.0f, rgbe[3] - (128 + 8)) : 0.0f;
+			dst[0] = rgbe[0] * f;
+			dst[1] = rgbe[1] * f;
+			dst[2] = rgbe[2] * f;
+		}
+	}
+
+	return img;
+}
+
+Image Images::downsample(const Image &src, bool srgb)
+{
+	Image dst;
+	dst.width = std::max(1, src.width / 2);
+	dst.height = std::max(1, src.height / 2);
+	dst.channels = src.channels;
+	dst.hdr = src.hdr;
+	dst.pixels.resize(dst.bytes());
+
+	int channels = src.channels;
+	// alpha is linear even in sRGB textures
+	int colorChannels = srgb && !src.hdr && channels >= 3 ? 3 : 0;
+
+	for (int y = 0; y < dst.height; ++y)
+	{
+		int y0 = std::min(y * 2, src.height - 1);
+		int y1 = std::min(y * 2 + 1, src.height - 1);
+		for (int x = 0; x < dst.width; ++x)
+		{
+			int x0 = std::min(x * 2, src.width - 1);
+			int x1 = std::min(x * 2 + 1, src.width - 1);
+			size_t i00 = (size_t(y0) * src.width + x0) * channels;
+			size_t i01 = (size_t(y0) * src.width + x1) * channels;
+			size_t i10 = (size_t(y1) * src.width + x0) * channels;
+			size_t i11 = (size_t(y1) * src.width + x1) * channels;
+			size_t o = (size_t(y) * dst.width + x) * channels;
+
+			if (src.hdr)
+			{
+				auto in = reinterpret_cast<const float *>(src.pixels.data());
+				auto out = reinterpret_cast<float *>(dst.pixels.data());
+				for (int c = 0; c < channels; ++c)
+					out[o + c] = (in[i00 + c] + in[i01 + c] + in[i10 + c] + in[i11 + c]) * 0.25f;
+				continue;
+			}
+
+			auto in = src.pixels.data();
+			auto out = dst.pixels.data();
+			for (int c = 0; c < channels; ++c)
+			{
+				if (c < colorChannels)
+				{
+					float sum = toLinear(in[i00 + c]) + toLinear(in[i01 + c]) + toLinear(in[i10 + c]) + toLinear(in[i11 + c]);
+					out[o + c] = toSrgb(sum * 0.25f);
+				}
+				else
+					out[o + c] = static_cast<byte>((in[i00 + c] + in[i01 + c] + in[i10 + c] + in[i11 + c] + 2) / 4);
+			}
+		}
+	}
+
+	return dst;
+}
+
+vector<Image> Images::mips(const Image &src, bool srgb)
+{
+	vector<Image> levels;
+	const Image *prev = &src;
+	while (prev->width > 1 || prev->height > 1)
+	{
+		levels.push_back(downsample(*prev, srgb));
+		prev = &levels.back();
+	}
+	return levels;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "types.hh"
+
+// Decoded pixels, rows top to bottom. 8 bit images keep their channel count,
+// HDR images are three floats per pixel.
+struct Image
+{
+	int width{ 0 };
+	int height{ 0 };
+	int channels{ 0 };
+	bool hdr{ false };
+	vector<byte> pixels;
+
+	bool valid() const { return width > 0 && height > 0 && !pixels.empty(); }
+	size_t pixelBytes() const { return size_t(channels) * (hdr ? sizeof(float) : 1); }
+	size_t bytes() const { return pixelBytes() * width * height; }
+
+	// GL upload parameters
+	uint internalFormat(bool srgb) const;
+	uint format() const;
+	uint type() const;
+};
+
+class Images
+{
+public:
+	static Image load(const string &path);
+	static Image decode(Span<byte> data);
+
+	static Image tga(Span<byte> data);
+	static Image png(Span<byte> data);
+	static Image hdr(Span<byte> data);
+
+	// 2x2 box filtered half size copy, sRGB colors are averaged in linear space
+	static Image downsample(const Image &src, bool srgb);
+	// levels 1..n down to 1x1, level 0 is the source itself
+	static vector<Image> mips(const Image &src, bool srgb);
+};
@@ -0,0 +1,78 @@
+#include "index_buffer.hh"
+#include <algorithm>
+
+uint IndexBuffer::pickType(u32 maxVertex)
+{
+	// 0xFFFF stays free for primitive restart
+	return maxVertex < 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t IndexBuffer::typeSize(uint type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE: return sizeof(u8);
+	case GL_UNSIGNED_SHORT: return sizeof(u16);
+	default: return sizeof(u32);
+	}
+}
+
+template <typename T>
+static vector<T> narrow(Span<u32> indices)
+{
+	vector<T> out(indices.size());
+	std::transform(indices.data(), indices.data() + indices.size(), begin(out), [](u32 i) { return static_cast<T>(i); });
+	return out;
+}
+
+bool IndexBuffer::create(Span<u32> indices, uint type)
+{
+	indexCount = indices.size();
+	minIndex = 0;
+	maxIndex = 0;
+	if (!indices.empty())
+	{
+		auto mm = std::minmax_element(indices.data(), indices.data() + indices.size());
+		minIndex = *mm.first;
+		maxIndex = *mm.second;
+	}
+
+	indexType = type ? type : pickType(maxIndex);
+	if (typeSize(indexType) < sizeof(u32) && maxIndex >= (1u << (8 * typeSize(indexType))))
+	{
+		std::cerr << "index_buffer: " << maxIndex << " does not fit requested index type\n";
+		return false;
+	}
+
+	buffer = gl.buffer.create();
+	switch (indexType)
+	{
+	case GL_UNSIGNED_BYTE: gl.buffer.namedData(buffer, narrow<u8>(indices)); break;
+	case GL_UNSIGNED_SHORT: gl.buffer.namedData(buffer, narrow<u16>(indices)); break;
+	default: gl.buffer.namedData(buffer, indices); break;
+	}
+
+	return true;
+}
+
+void IndexBuffer::del()
+{
+	if (buffer)
+		gl.buffer.del(buffer);
+	buffer = 0;
+	indexCount = 0;
+}
+
+void IndexBuffer::draw(uint mode, int baseVertex)
+{
+	draw(mode, 0, indexCount, baseVertex);
+}
+
+void IndexBuffer::draw(uint mode, size_t first, size_t count, int baseVertex)
+{
+	auto offset = typeSize(indexType) * first;
+	if (baseVertex == 0)
+		gl.draw.rangeElements(mode, minIndex, maxIndex, static_cast<int>(count), indexType, offset);
+	else
+		gl.draw.rangeElementsBaseVertex(mode, minIndex, maxIndex, static_cast<int>(count), baseVertex, offset, indexType);
+}
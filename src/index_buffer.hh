@@ -0,0 +1,36 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+
+// Index buffer that remembers its element type and the vertex range it
+// references, so draws pass the right count, type and range to the driver.
+// Attach it to a VAO with VertexArray::elementBuffer.
+class IndexBuffer
+{
+public:
+	// picks the narrowest type able to address maxVertex, 8-bit indices are
+	// only used when asked for explicitly since many GPUs convert them
+	static uint pickType(u32 maxVertex);
+	static size_t typeSize(uint type);
+
+	// type 0 selects automatically
+	bool create(Span<u32> indices, uint type = 0);
+	void del();
+
+	void draw(uint mode = GL_TRIANGLES, int baseVertex = 0);
+	void draw(uint mode, size_t first, size_t count, int baseVertex = 0);
+
+	uint id() const { return buffer; }
+	uint type() const { return indexType; }
+	size_t count() const { return indexCount; }
+	u32 minVertex() const { return minIndex; }
+	u32 maxVertex() const { return maxIndex; }
+
+private:
+	GL gl;
+	uint buffer{ 0 };
+	uint indexType{ GL_UNSIGNED_INT };
+	size_t indexCount{ 0 };
+	u32 minIndex{ 0 };
+	u32 maxIndex{ 0 };
+};
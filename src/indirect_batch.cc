@@ -0,0 +1,84 @@
+#include "indirect_batch.hh"
+#include <numeric>
+
+void IndirectBatch::create(size_t maxDraws)
+{
+	capacity = maxDraws;
+	commandBuffer = gl.buffer.create();
+	drawBuffer = gl.buffer.create();
+
+	vector<u32> ids(maxDraws);
+	std::iota(std::begin(ids), std::end(ids), 0);
+	drawIdBuffer = gl.buffer.create();
+	gl.buffer.storage(drawIdBuffer, sizeof(u32) * ids.size(), ids.data(), 0);
+}
+
+void IndirectBatch::del()
+{
+	for (auto buf : { commandBuffer, drawBuffer, drawIdBuffer })
+		if (buf)
+			gl.buffer.del(buf);
+	commandBuffer = drawBuffer = drawIdBuffer = 0;
+}
+
+void IndirectBatch::attach(uint vao)
+{
+	gl.vertexArray.enableAttrib(vao, DrawIdLocation);
+	gl.vertexArray.attribIFormat(vao, DrawIdLocation, 1, GL_UNSIGNED_INT, 0);
+	gl.vertexArray.attribBinding(vao, DrawIdLocation, DrawIdBinding);
+	gl.vertexArray.vertexBuffer(vao, DrawIdBinding, drawIdBuffer, 0, sizeof(u32));
+	gl.vertexArray.bindingDivisor(vao, DrawIdBinding, 1);
+}
+
+void IndirectBatch::begin()
+{
+	commands.clear();
+	draws.clear();
+}
+
+void IndirectBatch::add(u32 indexCount, u32 firstIndex, i32 baseVertex, const mat4 &model, u32 material)
+{
+	if (draws.size() >= capacity)
+	{
+		std::cerr << "indirect_batch: more than " << capacity << " draws\n";
+		return;
+	}
+
+	auto id = static_cast<u32>(draws.size());
+	draws.push_back({ model, material, {} });
+	commands.push_back({ indexCount, 1, firstIndex, baseVertex, id });
+}
+
+void IndirectBatch::add(const vector<DrawElementsIndirectCommand> &cmds, const mat4 &model, u32 material)
+{
+	if (draws.size() >= capacity)
+	{
+		std::cerr << "indirect_batch: more than " << capacity << " draws\n";
+		return;
+	}
+
+	auto id = static_cast<u32>(draws.size());
+	draws.push_back({ model, material, {} });
+	for (auto c : cmds)
+	{
+		c.baseInstance = id;
+		commands.push_back(c);
+	}
+}
+
+void IndirectBatch::upload()
+{
+	// re-specifying orphans last frame's storage instead of waiting on it
+	gl.buffer.namedData(commandBuffer, commands, GL_STREAM_DRAW);
+	gl.buffer.namedData(drawBuffer, draws, GL_STREAM_DRAW);
+}
+
+void IndirectBatch::submit(uint mode)
+{
+	if (commands.empty())
+		return;
+
+	gl.buffer.bind(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	gl.buffer.bindBase(GL_SHADER_STORAGE_BUFFER, DrawsBinding, drawBuffer);
+	gl.draw.multiElementsIndirect(mode, static_cast<int>(commands.size()));
+}
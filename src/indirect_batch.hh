@@ -0,0 +1,48 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+
+// Collects many indexed draws that share a VAO and program and submits them
+// with a single glMultiDrawElementsIndirect. Per-draw data lives in an SSBO;
+// each command's baseInstance indexes it through an instanced draw id
+// attribute, which works without ARB_shader_draw_parameters.
+class IndirectBatch
+{
+public:
+	static constexpr uint DrawsBinding = 0;
+	static constexpr uint DrawIdLocation = 2;
+	static constexpr uint DrawIdBinding = 1;
+
+	// std430 layout of `Draw` in res/shaders/pass_indirect/vert.glsl
+	struct DrawData
+	{
+		mat4 model;
+		u32 material;
+		u32 pad[3];
+	};
+	static_assert(sizeof(DrawData) == 80, "DrawData must match the std430 layout");
+
+	void create(size_t maxDraws);
+	void del();
+
+	// adds the draw id stream to a VAO, once per VAO
+	void attach(uint vao);
+
+	void begin();
+	void add(u32 indexCount, u32 firstIndex, i32 baseVertex, const mat4 &model, u32 material = 0);
+	// appends commands produced elsewhere (e.g. Meshlets::cull), all sharing one draw record
+	void add(const vector<DrawElementsIndirectCommand> &cmds, const mat4 &model, u32 material = 0);
+	void upload();
+	void submit(uint mode = GL_TRIANGLES);
+
+	size_t size() const { return commands.size(); }
+
+private:
+	GL gl;
+	size_t capacity{ 0 };
+	uint commandBuffer{ 0 };
+	uint drawBuffer{ 0 };
+	uint drawIdBuffer{ 0 };
+	vector<DrawElementsIndirectCommand> commands;
+	vector<DrawData> draws;
+};
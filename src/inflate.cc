@@ -0,0 +1,280 @@
+#include "inflate.hh"
+#include <iostream>
+
+namespace
+{
+	struct Bits
+	{
+		const byte *data;
+		size_t size;
+		// output bytes allowed in total
+		size_t limit;
+		size_t pos{ 0 };
+		u32 buffer{ 0 };
+		int count{ 0 };
+		bool overrun{ false };
+		bool full{ false };
+
+		Bits(Span<byte> in, size_t limit) : data(in.data()), size(in.size()), limit(limit) {}
+
+		bool room(const vector<byte> &out, size_t n)
+		{
+			full = n > limit - out.size();
+			return !full;
+		}
+
+		u32 get(int n)
+		{
+			while (count < n)
+			{
+				u32 next = 0;
+				if (pos < size)
+					next = data[pos++];
+				else
+					overrun = true;
+				buffer |= next << count;
+				count += 8;
+			}
+			u32 v = buffer & ((1u << n) - 1);
+			buffer >>= n;
+			count -= n;
+			return v;
+		}
+
+		void alignToByte()
+		{
+			buffer >>= count % 8;
+			count -= count % 8;
+		}
+	};
+
+	// canonical Huffman code as counts per length and symbols sorted by code
+	struct Huffman
+	{
+		static constexpr int MaxBits = 15;
+		u16 counts[MaxBits + 1]{};
+		u16 symbols[288]{};
+
+		bool build(const u8 *lengths, int n)
+		{
+			for (int i = 0; i < n; ++i)
+				++counts[lengths[i]];
+			counts[0] = 0;
+
+			u16 offsets[MaxBits + 2]{};
+			int left = 1;
+			for (int len = 1; len <= MaxBits; ++len)
+			{
+				left = left * 2 - counts[len];
+				if (left < 0)
+					return false;
+				offsets[len + 1] = offsets[len] + counts[len];
+			}
+			for (int i = 0; i < n; ++i)
+				if (lengths[i])
+					symbols[offsets[lengths[i]]++] = static_cast<u16>(i);
+			return true;
+		}
+
+		int decode(Bits &bits) const
+		{
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (int len = 1; len <= MaxBits; ++len)
+			{
+				code |= bits.get(1);
+				int count = counts[len];
+				if (code - first < count)
+					return symbols[index + code - first];
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	const u16 lengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const u8 lengthExtra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const u16 distBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const u8 distExtra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	bool codes(Bits &bits, const Huffman &lit, const Huffman &dist, vector<byte> &out)
+	{
+		for (;;)
+		{
+			int sym = lit.decode(bits);
+			if (sym < 0 || bits.overrun)
+				return false;
+			if (sym < 256)
+			{
+				if (!bits.room(out, 1))
+					return false;
+				out.push_back(static_cast<byte>(sym));
+			}
+			else if (sym == 256)
+				return true;
+			else
+			{
+				sym -= 257;
+				if (sym >= 29)
+					return false;
+				size_t len = lengthBase[sym] + bits.get(lengthExtra[sym]);
+
+				int d = dist.decode(bits);
+				if (d < 0 || d >= 30)
+					return false;
+				size_t distance = distBase[d] + bits.get(distExtra[d]);
+				if (distance > out.size() || !bits.room(out, len))
+					return false;
+
+				// byte by byte, copies may overlap their own output
+				size_t from = out.size() - distance;
+				for (size_t i = 0; i < len; ++i)
+					out.push_back(out[from + i]);
+			}
+		}
+	}
+
+	bool fixed(Bits &bits, vector<byte> &out)
+	{
+		static Huffman lit, dist;
+		static bool built = [] {
+			u8 lengths[288];
+			for (int i = 0; i < 144; ++i) lengths[i] = 8;
+			for (int i = 144; i < 256; ++i) lengths[i] = 9;
+			for (int i = 256; i < 280; ++i) lengths[i] = 7;
+			for (int i = 280; i < 288; ++i) lengths[i] = 8;
+			lit.build(lengths, 288);
+			for (int i = 0; i < 30; ++i) lengths[i] = 5;
+			dist.build(lengths, 30);
+			return true;
+		}();
+		(void)built;
+		return codes(bits, lit, dist, out);
+	}
+
+	bool dynamic(Bits &bits, vector<byte> &out)
+	{
+		static const u8 order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		int nlen = bits.get(5) + 257;
+		int ndist = bits.get(5) + 1;
+		int ncode = bits.get(4) + 4;
+		if (nlen > 286 || ndist > 30)
+			return false;
+
+		u8 lengths[320]{};
+		for (int i = 0; i < ncode; ++i)
+			lengths[order[i]] = static_cast<u8>(bits.get(3));
+
+		Huffman lencode;
+		if (!lencode.build(lengths, 19))
+			return false;
+
+		u8 all[320]{};
+		int n = 0;
+		while (n < nlen + ndist)
+		{
+			int sym = lencode.decode(bits);
+			if (sym < 0 || bits.overrun)
+				return false;
+			if (sym < 16)
+			{
+				all[n++] = static_cast<u8>(sym);
+				continue;
+			}
+
+			u8 value = 0;
+			int repeat = 0;
+			if (sym == 16)
+			{
+				if (n == 0)
+					return false;
+				value = all[n - 1];
+				repeat = 3 + bits.get(2);
+			}
+			else if (sym == 17)
+				repeat = 3 + bits.get(3);
+			else
+				repeat = 11 + bits.get(7);
+
+			if (n + repeat > nlen + ndist)
+				return false;
+			while (repeat--)
+				all[n++] = value;
+		}
+
+		if (all[256] == 0)
+			return false;
+
+		Huffman lit, dist;
+		if (!lit.build(all, nlen) || !dist.build(all + nlen, ndist))
+			return false;
+
+		return codes(bits, lit, dist, out);
+	}
+
+	bool stored(Bits &bits, vector<byte> &out)
+	{
+		bits.alignToByte();
+		u32 len = bits.get(16);
+		u32 nlen = bits.get(16);
+		if ((len ^ 0xFFFF) != nlen)
+			return false;
+
+		// the bit buffer is empty after reading two whole bytes
+		if (bits.pos + len > bits.size || !bits.room(out, len))
+			return false;
+		out.insert(end(out), bits.data + bits.pos, bits.data + bits.pos + len);
+		bits.pos += len;
+		return true;
+	}
+}
+
+bool Inflate::raw(Span<byte> in, vector<byte> &out, size_t limit)
+{
+	Bits bits(in, limit);
+	bool last = false;
+	while (!last)
+	{
+		last = bits.get(1) != 0;
+		bool ok = false;
+		switch (bits.get(2))
+		{
+		case 0: ok = stored(bits, out); break;
+		case 1: ok = fixed(bits, out); break;
+		case 2: ok = dynamic(bits, out); break;
+		default: break;
+		}
+		if (bits.full)
+		{
+			std::cerr << "inflate: output larger than " << limit << " bytes\n";
+			return false;
+		}
+		if (!ok || bits.overrun)
+		{
+			std::cerr << "inflate: corrupt deflate stream\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Inflate::zlib(Span<byte> in, vector<byte> &out, size_t limit)
+{
+	if (in.size() < 6)
+		return false;
+
+	u8 cmf = in.data()[0];
+	u8 flg = in.data()[1];
+	if ((cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20))
+	{
+		std::cerr << "inflate: unsupported zlib header\n";
+		return false;
+	}
+
+	// adler32 trailer is not verified, PNG chunks carry their own CRC
+	return raw(in.sub(2, in.size() - 2), out, limit);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "types.hh"
+#include <cstdint>
+
+// DEFLATE decoder (RFC 1951) with the zlib wrapper (RFC 1950) used by PNG.
+// Decodes the whole stream at once, output grows as needed and fails once
+// it would pass limit, callers that know the size pass it.
+class Inflate
+{
+public:
+	// longest output per input byte deflate can encode
+	static constexpr size_t MaxRatio = 1032;
+
+	static bool zlib(Span<byte> in, vector<byte> &out, size_t limit = SIZE_MAX);
+	static bool raw(Span<byte> in, vector<byte> &out, size_t limit = SIZE_MAX);
+};
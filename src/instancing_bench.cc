@@ -0,0 +1,96 @@
+#include "instancing_bench.hh"
+#include <chrono>
+#include <cmath>
+
+void InstancingBench::create(uint count, float spacing)
+{
+	uint side = static_cast<uint>(std::ceil(std::sqrt(float(count))));
+	extent = side * spacing;
+
+	models.clear();
+	models.reserve(count);
+	for (uint i = 0; i < count; ++i)
+	{
+		v3 pos((i % side) * spacing, 0, (i / side) * spacing);
+		models.push_back(glm::translate(mat4(1.0f), pos));
+	}
+
+	instanceBuffer = gl.buffer.create();
+	gl.buffer.storage(instanceBuffer, sizeof(mat4) * models.size(), models.data(), 0);
+
+	for (auto &q : queries)
+		q = gl.query.create(GL_TIME_ELAPSED);
+}
+
+void InstancingBench::del()
+{
+	if (instanceBuffer)
+		gl.buffer.del(instanceBuffer);
+	instanceBuffer = 0;
+	for (auto &q : queries)
+	{
+		if (q)
+			gl.query.del(q);
+		q = 0;
+	}
+}
+
+void InstancingBench::next()
+{
+	current = static_cast<Mode>((static_cast<int>(current) + 1) % 3);
+	cpu = gpu = 0;
+	frame = 0;
+}
+
+const char* InstancingBench::modeName() const
+{
+	switch (current)
+	{
+	case Mode::PerDraw: return "per draw uniform";
+	case Mode::Instanced: return "instanced";
+	default: return "off";
+	}
+}
+
+mat4 InstancingBench::view() const
+{
+	return glm::lookAt(v3(-extent * 0.1f, extent * 0.4f, -extent * 0.1f), v3(extent * 0.5f, 0, extent * 0.5f), UP);
+}
+
+void InstancingBench::draw(Programs &programs, UniformBlocks &blocks, const MeshHeap::Range &mesh)
+{
+	if (current == Mode::Off)
+		return;
+
+	// read the query issued two frames ago so the result never stalls
+	auto query = queries[frame % 2];
+	if (frame >= 2 && gl.query.available(query))
+		gpu = gl.query.result(query) / 1e6f;
+
+	auto count = static_cast<int>(mesh.indexCount);
+	auto baseVertex = static_cast<int>(mesh.vertexOffset);
+	auto indexOffset = sizeof(u32) * mesh.indexOffset;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	gl.query.begin(GL_TIME_ELAPSED, query);
+
+	if (current == Mode::PerDraw)
+	{
+		programs.use("pass");
+		for (const auto &model : models)
+		{
+			blocks.object(model);
+			gl.draw.elementsBaseVertex(GL_TRIANGLES, count, baseVertex, indexOffset);
+		}
+	}
+	else
+	{
+		programs.use(programs.variant("pass", { { "INSTANCED", "" } }));
+		gl.buffer.bindBase(GL_SHADER_STORAGE_BUFFER, InstancesBinding, instanceBuffer);
+		gl.draw.elementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, count, static_cast<int>(models.size()), baseVertex, 0, indexOffset);
+	}
+
+	gl.query.end(GL_TIME_ELAPSED);
+	cpu = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	++frame;
+}
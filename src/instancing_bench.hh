@@ -0,0 +1,47 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include "programs.hh"
+#include "mesh_heap.hh"
+#include "uniform_blocks.hh"
+
+// 100k cube scene drawn either with one object block and draw per cube or
+// with one instanced draw reading transforms from an SSBO. F2 in main.cc
+// cycles the modes; CPU submission time and GPU time are measured per frame.
+class InstancingBench
+{
+public:
+	enum class Mode
+	{
+		Off,
+		PerDraw,
+		Instanced,
+	};
+	static constexpr uint InstancesBinding = 1;
+
+	void create(uint count = 100000, float spacing = 2.0f);
+	void del();
+
+	void next();
+	Mode mode() const { return current; }
+	const char* modeName() const;
+	mat4 view() const;
+
+	// caller binds a VAO holding `mesh`; the frame block should use view()
+	void draw(Programs &programs, UniformBlocks &blocks, const MeshHeap::Range &mesh);
+
+	float cpuMs() const { return cpu; }
+	float gpuMs() const { return gpu; }
+	uint count() const { return static_cast<uint>(models.size()); }
+
+private:
+	GL gl;
+	Mode current{ Mode::Off };
+	vector<mat4> models;
+	float extent{ 0 };
+	uint instanceBuffer{ 0 };
+	uint queries[2]{};
+	uint frame{ 0 };
+	float cpu{ 0 };
+	float gpu{ 0 };
+};
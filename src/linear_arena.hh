@@ -0,0 +1,67 @@
+#pragma once
+#include "types.hh"
+#include <algorithm>
+#include <memory>
+
+// Bump allocator over fixed size chunks. reset() keeps the chunks, so after
+// the first frames recording allocates nothing. Not thread safe, use one
+// arena per thread.
+class LinearArena
+{
+public:
+	explicit LinearArena(size_t chunkSize = 64 * 1024) : chunkSize(chunkSize) {}
+
+	void *alloc(size_t size, size_t align)
+	{
+		size_t offset = (used + align - 1) & ~(align - 1);
+		if (current >= chunks.size() || offset + size > chunks[current].size)
+		{
+			next(size + align);
+			offset = 0;
+		}
+
+		used = offset + size;
+		return chunks[current].data.get() + offset;
+	}
+
+	void reset()
+	{
+		current = 0;
+		used = 0;
+	}
+
+	size_t capacity() const
+	{
+		size_t total = 0;
+		for (const auto &c : chunks)
+			total += c.size;
+		return total;
+	}
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<byte[]> data;
+		size_t size;
+	};
+
+	void next(size_t atLeast)
+	{
+		if (!chunks.empty() && used > 0)
+			++current;
+		while (current < chunks.size() && chunks[current].size < atLeast)
+			++current;
+		if (current >= chunks.size())
+		{
+			auto size = std::max(chunkSize, atLeast);
+			chunks.push_back({ std::unique_ptr<byte[]>(new byte[size]), size });
+			current = chunks.size() - 1;
+		}
+		used = 0;
+	}
+
+	size_t chunkSize;
+	vector<Chunk> chunks;
+	size_t current{ 0 };
+	size_t used{ 0 };
+};
@@ -9,24 +9,40 @@
 #include "log.hh"
 #include "ui.hh"
 #include "default_app.hh"
+#include "mesh_heap.hh"
+#include "mesh_optimizer.hh"
+#include "vertex_layout.hh"
+#include "quantize.hh"
+#include "render_queue.hh"
+#include "instancing_bench.hh"
+#include "uniform_blocks.hh"
+#include "textures.hh"
+#include "samplers.hh"
+#include "file_watcher.hh"
 #include <vector>
 #include <unordered_map>
 #include <sstream>
 
+struct Vertex
+{
+	v3 position;
+	Color8 color;
+};
+
+using PassLayout = VertexLayout<Attr<0, v3>, Attr<1, Color8>>;
+static_assert(PassLayout::matches<Vertex>);
+
 auto cube(float size)
 {
-	struct
-	{
-		vector<v3> verts;
-		vector<v3> colors;
-		vector<u32> indices;
-	} mesh;
+	MeshData<Vertex> mesh;
+	vector<v3> positions;
+	vector<v3> colors;
 
 	float half = size * 0.5f;
 	float top = size;
 	float bottom = 0;
 
-	mesh.verts = {
+	positions = {
 		// Face 1
 		// left bottom
 		v3(-half, bottom, -half),
@@ -118,20 +134,25 @@ auto cube(float size)
 
 	for (auto i = 0; i < 6; ++i)
 	{
-		mesh.colors.push_back(v3(1, 0, 0));
-		mesh.colors.push_back(v3(1, 1, 0));
-		mesh.colors.push_back(v3(0, 1, 0));
-		mesh.colors.push_back(v3(0, 1, 1));
-		mesh.colors.push_back(v3(0, 0, 1));
-		mesh.colors.push_back(v3(1, 0, 1));
+		colors.push_back(v3(1, 0, 0));
+		colors.push_back(v3(1, 1, 0));
+		colors.push_back(v3(0, 1, 0));
+		colors.push_back(v3(0, 1, 1));
+		colors.push_back(v3(0, 0, 1));
+		colors.push_back(v3(1, 0, 1));
 	}
 
+	for (size_t i = 0; i < positions.size(); ++i)
+		mesh.verts.push_back({ positions[i], Quantize::color(colors[i]) });
+
 	return std::move(mesh);
 }
 
 struct Resources
 {
 	Programs programs;
+	Textures textures;
+	Samplers samplers;
 };
 
 int main(int argc, char *argv[])
@@ -149,63 +170,83 @@ int main(int argc, char *argv[])
 	auto ctx = ui.init(app.wnd);
 
 	auto mesh = std::move(cube(1));
+	MeshOptimizer::print(std::cout, "cube", MeshOptimizer::optimize(mesh));
 
-	uint vao = gl.vertexArray.create();
-	gl.vertexArray.bind(vao);
-
-	uint vbo = gl.buffer.gen();
-	gl.buffer.array.bind(vbo);
-	gl.buffer.array.data(mesh.verts);
+	MeshHeap heap;
+	heap.create(PassLayout::stride, 1 << 16, 1 << 18);
+	uint cubeMesh = heap.add(mesh.verts, mesh.indices);
 
-	uint cbo = gl.buffer.gen();
-	gl.buffer.array.bind(cbo);
-	gl.buffer.array.data(mesh.colors);
-
-	uint ibo = gl.buffer.gen();
-	gl.buffer.element.bind(ibo);
-	gl.buffer.element.data(mesh.indices);
-		
-	gl.vertexAttrib.enableArray(0);
-	gl.buffer.array.bind(vbo);
-	gl.vertexAttrib.pointerFloat(0, 3);
-
-	gl.vertexAttrib.enableArray(1);
-	gl.buffer.array.bind(cbo);
-	gl.vertexAttrib.pointerFloat(1, 3);
-
-	gl.buffer.element.bind(0);
-	gl.buffer.array.bind(0);
-	gl.vertexArray.bind(0);
+	uint vao = gl.vertexArray.create();
+	PassLayout::setup(vao);
+	PassLayout::bind(vao, heap.vertexBuffer());
+	gl.vertexArray.elementBuffer(vao, heap.indexBuffer());
 
 	gl.cullFace.enable();
 	gl.cullFace.back();
 
+	res.programs.attach(app.executor());
+	res.textures.create(app.executor());
 	res.programs.load("pass");
+	res.programs.fallback("pass");
+
+	FileWatcher shaderWatcher;
+	shaderWatcher.watch(SHADERS_PATH);
 
 	mat4 view = glm::lookAt(v3(-2, 10, 10), v3(0, 0, 0), UP);
+	RenderQueue queue;
+	InstancingBench bench;
+	bench.create();
+	UniformBlocks blocks;
+	blocks.create(bench.count() + 4096);
 
 	while (app.isOpen())
 	{
 		ui.beginFrame();
+		ImGui::Begin("stats");
+		ImGui::Text("gl state: %u issued, %u skipped", gl.state().last.issued, gl.state().last.skipped);
+		ImGui::Text("uniforms: %u issued, %u skipped", res.programs.last.issued, res.programs.last.skipped);
+		ImGui::Text("textures: %u pending, programs: %u compiling", res.textures.pending(), res.programs.pending());
+		ImGui::Text("bench (F2): %s, %u cubes", bench.modeName(), bench.count());
+		ImGui::Text("bench: cpu %.3f ms, gpu %.3f ms", bench.cpuMs(), bench.gpuMs());
+		ImGui::End();
 		ui.endFrame();
 
+		res.textures.update();
+		auto changed = shaderWatcher.poll();
+		if (!changed.empty())
+			res.programs.reloadFiles(changed);
+		res.programs.update();
+
 		auto size = app.framebufferSize();
 		auto proj = gl.m.fov(55, size);
 		auto model = mat4(1.0f);
+		blocks.beginFrame(bench.mode() == InstancingBench::Mode::Off ? view : bench.view(), proj, static_cast<float>(glfwGetTime()));
 		gl.viewport.set(size);
 		gl.clear.depthBuffer();
 		gl.clear.colorBuffer(v3(0.3f, 0.3f, 0.3f));
 		
 		//
-		gl.vertexArray.bind(vao);
-		gl.buffer.element.bind(ibo);
-		res.programs.use("pass");
-		res.programs.uniform("PROJ", proj);
-		res.programs.uniform("VIEW", view);
-		res.programs.uniform("MODEL", model);
-		gl.draw.triangles.elements(mesh.indices.size());
+		queue.begin(1000);
+		const auto &range = heap.range(cubeMesh);
+		DrawPacket packet;
+		packet.program = res.programs.readyId("pass");
+		packet.vertexArray = vao;
+		packet.firstIndex = static_cast<u32>(range.indexOffset);
+		packet.indexCount = static_cast<u32>(range.indexCount);
+		packet.baseVertex = static_cast<i32>(range.vertexOffset);
+		packet.depth = glm::length(v3(view * model[3]));
+		queue.push(packet);
+		queue.sort();
+
+		queue.submit([&](const DrawPacket &) {
+			blocks.object(model);
+		});
+		bench.draw(res.programs, blocks, range);
+		blocks.endFrame();
 		//
 		ui.draw();
+		gl.state().endFrame();
+		res.programs.endFrame();
 		app.process();
 
 		if (app.keyPress(GLFW_KEY_ESCAPE))
@@ -213,21 +254,20 @@ int main(int argc, char *argv[])
 
 		if (app.keyReleasedOnce(GLFW_KEY_F5))
 			res.programs.reloadAll();
+
+		if (app.keyReleasedOnce(GLFW_KEY_F2))
+			bench.next();
 	}
 
-	gl.vertexArray.bind(vao);
-	gl.vertexAttrib.disableArray(1);
-	gl.vertexAttrib.disableArray(0);
+	bench.del();
+	blocks.del();
 	gl.vertexArray.bind(0);
 	gl.vertexArray.del(vao);
-
-	gl.buffer.element.bind(0);
-	gl.buffer.del(ibo);
-	gl.buffer.array.bind(0);
-	gl.buffer.del(vbo);
-	gl.buffer.del(cbo);
+	heap.del();
 
 	res.programs.delAll();
+	res.textures.del();
+	res.samplers.del();
 
 	ui.terminate();
 
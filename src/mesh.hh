@@ -0,0 +1,10 @@
+#pragma once
+#include "types.hh"
+
+// CPU-side indexed mesh, V is any trivially copyable vertex struct
+template <typename V>
+struct MeshData
+{
+	vector<V> verts;
+	vector<u32> indices;
+};
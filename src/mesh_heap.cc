@@ -0,0 +1,131 @@
+#include "mesh_heap.hh"
+#include "log.hh"
+
+bool MeshHeap::create(size_t vertexStride, size_t vertexCapacity, size_t indexCapacity)
+{
+	stride = vertexStride;
+	vertices.reset(vertexCapacity);
+	indices.reset(indexCapacity);
+	meshes.clear();
+	freeHandles.clear();
+
+	vbo = gl.buffer.create();
+	gl.buffer.storage(vbo, stride * vertexCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	ibo = gl.buffer.create();
+	gl.buffer.storage(ibo, sizeof(u32) * indexCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	return vbo && ibo;
+}
+
+void MeshHeap::del()
+{
+	if (vbo)
+		gl.buffer.del(vbo);
+	if (ibo)
+		gl.buffer.del(ibo);
+	vbo = ibo = 0;
+	meshes.clear();
+	freeHandles.clear();
+}
+
+uint MeshHeap::add(const void *verts, size_t vertexCount, const u32 *idx, size_t indexCount)
+{
+	auto vertexOffset = vertices.alloc(vertexCount);
+	if (vertexOffset == RangeAllocator::Invalid)
+	{
+		std::cerr << "mesh_heap: out of vertex space (" << vertexCount << " vertices requested)\n";
+		return Invalid;
+	}
+
+	auto indexOffset = indices.alloc(indexCount);
+	if (indexOffset == RangeAllocator::Invalid)
+	{
+		std::cerr << "mesh_heap: out of index space (" << indexCount << " indices requested)\n";
+		vertices.free(vertexOffset);
+		return Invalid;
+	}
+
+	gl.buffer.subData(vbo, stride * vertexOffset, stride * vertexCount, verts);
+	gl.buffer.subData(ibo, sizeof(u32) * indexOffset, sizeof(u32) * indexCount, idx);
+
+	uint handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<uint>(meshes.size());
+		meshes.emplace_back();
+	}
+	meshes[handle] = { vertexOffset, vertexCount, indexOffset, indexCount, true };
+
+	return handle;
+}
+
+void MeshHeap::remove(uint mesh)
+{
+	auto &r = meshes[mesh];
+	assert(r.alive);
+	vertices.free(r.vertexOffset);
+	indices.free(r.indexOffset);
+	r = Range{};
+	freeHandles.push_back(mesh);
+}
+
+void MeshHeap::draw(uint mesh, uint mode)
+{
+	const auto &r = meshes[mesh];
+	gl.draw.rangeElementsBaseVertex(mode, 0, static_cast<uint>(r.vertexCount - 1), static_cast<int>(r.indexCount),
+		static_cast<int>(r.vertexOffset), sizeof(u32) * r.indexOffset);
+}
+
+void MeshHeap::defragment()
+{
+	compact(vbo, vertices, stride, true);
+	compact(ibo, indices, sizeof(u32), false);
+}
+
+MeshHeap::Stats MeshHeap::stats() const
+{
+	return { vertices.stats(), indices.stats(), static_cast<uint>(meshes.size() - freeHandles.size()) };
+}
+
+void MeshHeap::compact(uint buf, RangeAllocator &allocator, size_t elementSize, bool isVertices)
+{
+	auto live = allocator.allocations();
+	unordered_map<size_t, size_t> moved;
+	size_t packed = 0;
+	bool dirty = false;
+	for (const auto &a : live)
+	{
+		moved[a.first] = packed;
+		dirty |= a.first != packed;
+		packed += a.second;
+	}
+	if (!dirty)
+		return;
+
+	// glCopyBufferSubData forbids overlapping ranges within one buffer,
+	// so pack into a staging buffer first and copy the result back in one go
+	uint staging = gl.buffer.create();
+	gl.buffer.storage(staging, elementSize * packed, nullptr, 0);
+	for (const auto &a : live)
+		gl.buffer.copy(buf, staging, elementSize * a.first, elementSize * moved[a.first], elementSize * a.second);
+	gl.buffer.copy(staging, buf, 0, 0, elementSize * packed);
+	gl.buffer.del(staging);
+
+	// reallocating in address order reproduces the packed layout
+	allocator.reset(allocator.stats().capacity);
+	for (const auto &a : live)
+		allocator.alloc(a.second);
+
+	for (auto &r : meshes)
+	{
+		if (!r.alive)
+			continue;
+		auto &offset = isVertices ? r.vertexOffset : r.indexOffset;
+		offset = moved[offset];
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include "range_allocator.hh"
+#include <cassert>
+#include <type_traits>
+
+// One vertex and one index buffer shared by many static meshes. Indices are
+// stored relative to the mesh so draws only differ by base vertex and index
+// offset, and the buffers never have to be rebound between meshes.
+class MeshHeap
+{
+public:
+	static constexpr uint Invalid = ~uint(0);
+
+	struct Range
+	{
+		size_t vertexOffset{ 0 };
+		size_t vertexCount{ 0 };
+		size_t indexOffset{ 0 };
+		size_t indexCount{ 0 };
+		bool alive{ false };
+	};
+
+	struct Stats
+	{
+		RangeAllocator::Stats vertices;
+		RangeAllocator::Stats indices;
+		uint meshes{ 0 };
+	};
+
+	bool create(size_t vertexStride, size_t vertexCapacity, size_t indexCapacity);
+	void del();
+
+	template <typename V>
+	uint add(const vector<V> &verts, const vector<u32> &indices)
+	{
+		static_assert(std::is_trivially_copyable_v<V>, "mesh heap needs trivially copyable vertices");
+		assert(sizeof(V) == stride);
+		return add(verts.data(), verts.size(), indices.data(), indices.size());
+	}
+	uint add(const void *verts, size_t vertexCount, const u32 *indices, size_t indexCount);
+	void remove(uint mesh);
+
+	void draw(uint mesh, uint mode = GL_TRIANGLES);
+	const Range& range(uint mesh) const { return meshes[mesh]; }
+
+	// compacts live meshes to the front of both buffers, buffer names and
+	// mesh handles stay valid; meant for loading screens
+	void defragment();
+	Stats stats() const;
+
+	uint vertexBuffer() const { return vbo; }
+	uint indexBuffer() const { return ibo; }
+	size_t vertexStride() const { return stride; }
+
+private:
+	void compact(uint buf, RangeAllocator &allocator, size_t elementSize, bool vertices);
+
+	GL gl;
+	uint vbo{ 0 };
+	uint ibo{ 0 };
+	size_t stride{ 0 };
+	RangeAllocator vertices;
+	RangeAllocator indices;
+	vector<Range> meshes;
+	vector<uint> freeHandles;
+};
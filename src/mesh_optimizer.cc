@@ -0,0 +1,192 @@
+#include "mesh_optimizer.hh"
+#include <taskflow.hpp>
+#include <cstring>
+#include <iomanip>
+
+namespace
+{
+	struct VertexKey
+	{
+		const byte *data;
+		size_t stride;
+
+		bool operator==(const VertexKey &o) const
+		{
+			return std::memcmp(data, o.data, stride) == 0;
+		}
+	};
+
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey &k) const
+		{
+			// FNV-1a
+			u64 h = 14695981039346656037ull;
+			for (size_t i = 0; i < k.stride; ++i)
+				h = (h ^ k.data[i]) * 1099511628211ull;
+			return static_cast<size_t>(h);
+		}
+	};
+}
+
+size_t MeshOptimizer::weldRemap(const void *verts, size_t count, size_t stride, vector<u32> &remap)
+{
+	auto bytes = static_cast<const byte *>(verts);
+	std::unordered_map<VertexKey, u32, VertexKeyHash> unique;
+	unique.reserve(count);
+
+	remap.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto inserted = unique.emplace(VertexKey{ bytes + i * stride, stride }, static_cast<u32>(unique.size()));
+		remap[i] = inserted.first->second;
+	}
+
+	return unique.size();
+}
+
+// Tipsify, Sander et al. 2007 "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+void MeshOptimizer::vertexCache(vector<u32> &indices, size_t vertexCount, uint cacheSize)
+{
+	auto triCount = indices.size() / 3;
+	if (triCount == 0)
+		return;
+
+	// vertex -> triangle adjacency
+	vector<u32> live(vertexCount, 0);
+	for (auto i : indices)
+		++live[i];
+	vector<u32> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + live[v];
+	vector<u32> adjacency(indices.size());
+	{
+		auto fill = offsets;
+		for (size_t i = 0; i < indices.size(); ++i)
+			adjacency[fill[indices[i]]++] = static_cast<u32>(i / 3);
+	}
+
+	vector<u32> timestamps(vertexCount, 0);
+	vector<bool> emitted(triCount, false);
+	vector<u32> deadEnd;
+	vector<u32> candidates;
+	vector<u32> out;
+	out.reserve(indices.size());
+
+	u32 time = cacheSize + 1;
+	size_t cursor = 0;
+	i64 fanning = 0;
+
+	auto skipDeadEnd = [&]() -> i64 {
+		while (!deadEnd.empty())
+		{
+			auto d = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[d] > 0)
+				return d;
+		}
+		for (; cursor < vertexCount; ++cursor)
+			if (live[cursor] > 0)
+				return static_cast<i64>(cursor);
+		return -1;
+	};
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+		for (auto a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+		{
+			auto t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			for (auto k = 0; k < 3; ++k)
+			{
+				auto v = indices[t * 3 + k];
+				out.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--live[v];
+				if (time - timestamps[v] > cacheSize)
+					timestamps[v] = time++;
+			}
+			emitted[t] = true;
+		}
+
+		// prefer the candidate that stays in cache the longest while
+		// still having triangles left to emit
+		i64 next = -1;
+		i64 best = -1;
+		for (auto v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+			i64 priority = 0;
+			if (time - timestamps[v] + 2 * live[v] <= cacheSize)
+				priority = time - timestamps[v];
+			if (priority > best)
+			{
+				best = priority;
+				next = v;
+			}
+		}
+		fanning = next >= 0 ? next : skipDeadEnd();
+	}
+
+	indices = std::move(out);
+}
+
+size_t MeshOptimizer::fetchRemap(const vector<u32> &indices, size_t vertexCount, vector<u32> &remap)
+{
+	remap.assign(vertexCount, ~0u);
+	u32 next = 0;
+	for (auto i : indices)
+		if (remap[i] == ~0u)
+			remap[i] = next++;
+
+	return next;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyze(const vector<u32> &indices, size_t vertexCount, uint cacheSize)
+{
+	CacheStats stats;
+	if (indices.empty())
+		return stats;
+
+	// FIFO cache, the way most post-transform caches behave
+	vector<u32> insertedAt(vertexCount, 0);
+	vector<bool> referenced(vertexCount, false);
+	size_t misses = 0;
+	size_t unique = 0;
+	for (auto i : indices)
+	{
+		if (!referenced[i])
+		{
+			referenced[i] = true;
+			++unique;
+		}
+		if (insertedAt[i] == 0 || misses - insertedAt[i] + 1 > cacheSize)
+			insertedAt[i] = static_cast<u32>(++misses);
+	}
+
+	stats.acmr = float(misses) / float(indices.size() / 3);
+	stats.atvr = float(misses) / float(unique);
+	return stats;
+}
+
+void MeshOptimizer::print(std::ostream &out, const string &name, const Report &r)
+{
+	out << "mesh/" << name << ": "
+		<< std::fixed << std::setprecision(2)
+		<< "verts " << r.vertsBefore << " -> " << r.vertsAfter
+		<< ", acmr " << r.before.acmr << " -> " << r.after.acmr
+		<< ", atvr " << r.before.atvr << " -> " << r.after.atvr
+		<< std::defaultfloat << "\n";
+}
+
+void MeshOptimizer::parallel(tf::Executor &executor, size_t count, const std::function<void(size_t)> &fn)
+{
+	tf::Taskflow taskflow;
+	taskflow.parallel_for(size_t(0), count, size_t(1), [&fn](size_t i) { fn(i); });
+	executor.run(taskflow).get();
+}
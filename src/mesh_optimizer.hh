@@ -0,0 +1,100 @@
+#pragma once
+#include "types.hh"
+#include "mesh.hh"
+#include <functional>
+#include <ostream>
+#include <type_traits>
+
+namespace tf { class Executor; }
+
+// Offline/load-time mesh optimization: weld duplicate vertices, reorder
+// triangles for the post-transform cache (Tipsify) and reorder vertices
+// by first use for fetch locality.
+class MeshOptimizer
+{
+public:
+	static constexpr uint CacheSize = 16;
+
+	struct CacheStats
+	{
+		float acmr{ 0 }; // transformed vertices per triangle, 0.5 is ideal
+		float atvr{ 0 }; // transformed vertices per unique vertex, 1.0 is ideal
+	};
+
+	struct Report
+	{
+		size_t vertsBefore{ 0 };
+		size_t vertsAfter{ 0 };
+		CacheStats before;
+		CacheStats after;
+	};
+
+	// index remap of the unique vertices, returns the unique vertex count
+	static size_t weldRemap(const void *verts, size_t count, size_t stride, vector<u32> &remap);
+	static void vertexCache(vector<u32> &indices, size_t vertexCount, uint cacheSize = CacheSize);
+	// remap by first use in the index stream, unreferenced vertices map to ~0u
+	static size_t fetchRemap(const vector<u32> &indices, size_t vertexCount, vector<u32> &remap);
+	static CacheStats analyze(const vector<u32> &indices, size_t vertexCount, uint cacheSize = CacheSize);
+
+	template <typename V>
+	static void weld(MeshData<V> &mesh)
+	{
+		static_assert(std::is_trivially_copyable_v<V>, "weld compares vertices bytewise");
+		vector<u32> remap;
+		auto unique = weldRemap(mesh.verts.data(), mesh.verts.size(), sizeof(V), remap);
+		apply(mesh, remap, unique);
+	}
+
+	template <typename V>
+	static void vertexFetch(MeshData<V> &mesh)
+	{
+		vector<u32> remap;
+		auto used = fetchRemap(mesh.indices, mesh.verts.size(), remap);
+		apply(mesh, remap, used);
+	}
+
+	template <typename V>
+	static Report optimize(MeshData<V> &mesh)
+	{
+		Report r;
+		r.vertsBefore = mesh.verts.size();
+		r.before = analyze(mesh.indices, mesh.verts.size());
+
+		weld(mesh);
+		vertexCache(mesh.indices, mesh.verts.size());
+		vertexFetch(mesh);
+
+		r.vertsAfter = mesh.verts.size();
+		r.after = analyze(mesh.indices, mesh.verts.size());
+		return r;
+	}
+
+	// optimizes every mesh in parallel on the executor and waits
+	template <typename V>
+	static vector<Report> optimizeAll(tf::Executor &executor, vector<MeshData<V>> &meshes)
+	{
+		vector<Report> reports(meshes.size());
+		parallel(executor, meshes.size(), [&meshes, &reports](size_t i) {
+			reports[i] = optimize(meshes[i]);
+		});
+		return reports;
+	}
+
+	static void print(std::ostream &out, const string &name, const Report &r);
+
+private:
+	static void parallel(tf::Executor &executor, size_t count, const std::function<void(size_t)> &fn);
+
+	template <typename V>
+	static void apply(MeshData<V> &mesh, const vector<u32> &remap, size_t count)
+	{
+		vector<V> verts(count);
+		for (size_t i = 0; i < remap.size(); ++i)
+			if (remap[i] != ~0u)
+				verts[remap[i]] = mesh.verts[i];
+
+		for (auto &i : mesh.indices)
+			i = remap[i];
+		mesh.verts = std::move(verts);
+	}
+};
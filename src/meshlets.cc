@@ -0,0 +1,115 @@
+#include "meshlets.hh"
+#include <algorithm>
+
+Meshlets Meshlets::build(Span<v3> positions, const vector<u32> &source)
+{
+	Meshlets out;
+	out.indices.reserve(source.size());
+
+	// marks vertices already referenced by the current meshlet
+	vector<u32> seen(positions.size(), ~0u);
+	Meshlet current{};
+
+	auto flush = [&]() {
+		if (current.indexCount == 0)
+			return;
+		bounds(current, positions, out.indices.data() + current.firstIndex);
+		out.meshlets.push_back(current);
+		current = Meshlet{};
+		current.firstIndex = static_cast<u32>(out.indices.size());
+	};
+
+	for (size_t t = 0; t + 2 < source.size(); t += 3)
+	{
+		const u32 *tri = &source[t];
+		uint added = 0;
+		auto id = static_cast<u32>(out.meshlets.size());
+		for (int k = 0; k < 3; ++k)
+			added += seen[tri[k]] != id && (k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]);
+
+		if (current.vertexCount + added > MaxVertices || current.indexCount / 3 + 1 > MaxTriangles)
+		{
+			flush();
+			id = static_cast<u32>(out.meshlets.size());
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			if (seen[tri[k]] != id)
+			{
+				seen[tri[k]] = id;
+				++current.vertexCount;
+			}
+			out.indices.push_back(tri[k]);
+		}
+		current.indexCount += 3;
+	}
+	flush();
+
+	return out;
+}
+
+void Meshlets::bounds(Meshlet &m, Span<v3> positions, const u32 *tris)
+{
+	const v3 *p = positions.data();
+
+	v3 lo = p[tris[0]];
+	v3 hi = lo;
+	for (u32 i = 0; i < m.indexCount; ++i)
+	{
+		lo = glm::min(lo, p[tris[i]]);
+		hi = glm::max(hi, p[tris[i]]);
+	}
+	v3 center = (lo + hi) * 0.5f;
+	float radius = 0;
+	for (u32 i = 0; i < m.indexCount; ++i)
+		radius = std::max(radius, glm::length(p[tris[i]] - center));
+	m.sphere = v4(center, radius);
+
+	// normal cone, area weighted average of triangle normals
+	v3 axis(0);
+	vector<v3> normals;
+	normals.reserve(m.indexCount / 3);
+	for (u32 i = 0; i < m.indexCount; i += 3)
+	{
+		auto n = glm::cross(p[tris[i + 1]] - p[tris[i]], p[tris[i + 2]] - p[tris[i]]);
+		axis += n;
+		auto len = glm::length(n);
+		if (len > 0)
+			normals.push_back(n / len);
+	}
+
+	float axisLen = glm::length(axis);
+	if (axisLen == 0 || normals.empty())
+	{
+		m.cone = v4(0, 0, 1, 1);
+		return;
+	}
+	axis /= axisLen;
+
+	float minDot = 1;
+	for (const auto &n : normals)
+		minDot = std::min(minDot, glm::dot(axis, n));
+
+	// spread over 90 degrees can always be seen from somewhere in front
+	float cutoff = minDot <= 0 ? 1 : std::sqrt(1 - minDot * minDot);
+	m.cone = v4(axis, cutoff);
+}
+
+bool Meshlets::visible(const Meshlet &m, const Frustum &frustum, const v3 &camera)
+{
+	v3 center(m.sphere);
+	if (!frustum.sphere(center, m.sphere.w))
+		return false;
+
+	v3 toCenter = center - camera;
+	return glm::dot(toCenter, v3(m.cone)) < m.cone.w * glm::length(toCenter) + m.sphere.w;
+}
+
+void Meshlets::cull(const Frustum &frustum, const v3 &camera, vector<DrawElementsIndirectCommand> &out,
+	u32 firstIndex, i32 baseVertex, u32 baseInstance) const
+{
+	for (const auto &m : meshlets)
+		if (visible(m, frustum, camera))
+			out.push_back({ m.indexCount, 1, firstIndex + m.firstIndex, baseVertex, baseInstance });
+}
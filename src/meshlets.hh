@@ -0,0 +1,51 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include "mesh.hh"
+#include "frustum.hh"
+
+// Splits an indexed mesh into small clusters that can be culled one by one.
+// Each meshlet's triangles are stored contiguously in `indices`, so a
+// visible meshlet is one DrawElementsIndirectCommand.
+class Meshlets
+{
+public:
+	static constexpr uint MaxVertices = 64;
+	static constexpr uint MaxTriangles = 124;
+
+	// std430 compatible, upload `meshlets` as is to an SSBO
+	struct Meshlet
+	{
+		v4 sphere;     // center xyz, radius w
+		v4 cone;       // axis xyz, cutoff w (1 disables cone culling)
+		u32 firstIndex;
+		u32 indexCount;
+		u32 vertexCount;
+		u32 pad;
+	};
+	static_assert(sizeof(Meshlet) == 48, "Meshlet must match the std430 layout");
+
+	vector<Meshlet> meshlets;
+	vector<u32> indices;
+
+	static Meshlets build(Span<v3> positions, const vector<u32> &indices);
+
+	template <typename V>
+	static Meshlets build(const MeshData<V> &mesh, v3 V::*position)
+	{
+		vector<v3> positions;
+		positions.reserve(mesh.verts.size());
+		for (const auto &v : mesh.verts)
+			positions.push_back(v.*position);
+		return build(positions, mesh.indices);
+	}
+
+	// camera and frustum in the mesh's object space; firstIndex and baseVertex
+	// locate `indices` and the vertices in the GPU buffers
+	void cull(const Frustum &frustum, const v3 &camera, vector<DrawElementsIndirectCommand> &out,
+		u32 firstIndex = 0, i32 baseVertex = 0, u32 baseInstance = 0) const;
+	static bool visible(const Meshlet &m, const Frustum &frustum, const v3 &camera);
+
+private:
+	static void bounds(Meshlet &m, Span<v3> positions, const u32 *tris);
+};
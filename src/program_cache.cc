@@ -0,0 +1,87 @@
+#include "program_cache.hh"
+#include "files.hh"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	const u32 Magic = 0x42505247; // "GRPB"
+
+	struct Header
+	{
+		u32 magic;
+		u32 format;
+		u64 key;
+	};
+
+	u64 fnv(u64 h, const string &s)
+	{
+		for (char c : s)
+		{
+			h ^= static_cast<u8>(c);
+			h *= 1099511628211ull;
+		}
+		// separator so "ab" + "c" and "a" + "bc" differ
+		h ^= 0xFF;
+		h *= 1099511628211ull;
+		return h;
+	}
+}
+
+u64 ProgramCache::key(const strings &sources, const string &defines)
+{
+	GL gl;
+	u64 h = 14695981039346656037ull;
+	for (const auto &source : sources)
+		h = fnv(h, source);
+	h = fnv(h, defines);
+	h = fnv(h, gl.getString(GL_RENDERER));
+	h = fnv(h, gl.getString(GL_VERSION));
+	return h;
+}
+
+string ProgramCache::path(const string &name) const
+{
+	// variant names may contain separators
+	string file = name;
+	for (auto &c : file)
+		if (c == '/' || c == '\\' || c == ':')
+			c = '_';
+	return string(CACHE_PATH) + file + ".bin";
+}
+
+bool ProgramCache::load(const string &name, u64 key, uint program)
+{
+	vector<byte> data;
+	if (!Files::readBinary(path(name), data) || data.size() <= sizeof(Header))
+		return false;
+
+	Header header;
+	std::memcpy(&header, data.data(), sizeof(header));
+	if (header.magic != Magic || header.key != key)
+		return false;
+
+	gl.program.binary(program, header.format, Span<byte>(data.data() + sizeof(header), data.size() - sizeof(header)));
+	return gl.program.getInt(program, GL_LINK_STATUS) != 0;
+}
+
+void ProgramCache::save(const string &name, u64 key, uint program)
+{
+	Header header{ Magic, 0, key };
+	auto binary = gl.program.binary(program, header.format);
+	if (binary.empty())
+		return;
+
+	std::error_code ec;
+	std::filesystem::create_directories(CACHE_PATH, ec);
+
+	std::ofstream out(path(name), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cerr << "program_cache: cannot write " << path(name) << "\n";
+		return;
+	}
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+
+// Linked program binaries on disk under CACHE_PATH, one file per program.
+// The key covers every stage source, the define set and the driver, so a
+// stale or foreign binary is never offered to glProgramBinary; the driver
+// may still reject one, callers then compile from source.
+class ProgramCache
+{
+public:
+	static u64 key(const strings &sources, const string &defines = "");
+
+	bool load(const string &name, u64 key, uint program);
+	void save(const string &name, u64 key, uint program);
+
+private:
+	string path(const string &name) const;
+
+	GL gl;
+};
@@ -0,0 +1,154 @@
+#include "program_reflection.hh"
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+	void add(GL &gl, uint program, uint iface, ProgramReflection::Kind kind, vector<ProgramReflection::Resource> &out)
+	{
+		using Kind = ProgramReflection::Kind;
+
+		int count = gl.program.interfaceInt(program, iface, GL_ACTIVE_RESOURCES);
+		int maxName = gl.program.interfaceInt(program, iface, GL_MAX_NAME_LENGTH);
+
+		for (int i = 0; i < count; ++i)
+		{
+			ProgramReflection::Resource r;
+			r.kind = kind;
+			r.name = gl.program.resourceName(program, iface, i, maxName);
+
+			// arrays are reported as "name[0]", look them up by their plain name
+			auto bracket = r.name.find("[0]");
+			if (bracket != string::npos && bracket + 3 == r.name.size())
+				r.name.resize(bracket);
+
+			if (kind == Kind::Uniform)
+			{
+				const uint props[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX, GL_OFFSET };
+				int values[5];
+				gl.program.resource(program, iface, i, props, values);
+				r.type = values[0];
+				r.arraySize = values[1];
+				r.location = values[2];
+				r.block = values[3];
+				r.offset = values[4];
+			}
+			else
+			{
+				const uint props[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+				int values[2];
+				gl.program.resource(program, iface, i, props, values);
+				r.binding = values[0];
+				r.dataSize = values[1];
+			}
+
+			r.hash = nameHash(r.name);
+			out.push_back(std::move(r));
+		}
+	}
+
+	bool less(const ProgramReflection::Resource &a, ProgramReflection::Kind kind, u32 hash)
+	{
+		return std::tie(a.kind, a.hash) < std::tie(kind, hash);
+	}
+}
+
+ProgramReflection ProgramReflection::reflect(uint program)
+{
+	GL gl;
+	ProgramReflection r;
+	add(gl, program, GL_UNIFORM, Kind::Uniform, r.resources);
+	add(gl, program, GL_UNIFORM_BLOCK, Kind::UniformBlock, r.resources);
+	add(gl, program, GL_SHADER_STORAGE_BLOCK, Kind::StorageBlock, r.resources);
+
+	std::sort(begin(r.resources), end(r.resources), [](const Resource &a, const Resource &b) {
+		return std::tie(a.kind, a.hash) < std::tie(b.kind, b.hash);
+	});
+
+	for (size_t i = 1; i < r.resources.size(); ++i)
+	{
+		const auto &a = r.resources[i - 1];
+		const auto &b = r.resources[i];
+		if (a.kind == b.kind && a.hash == b.hash)
+			std::cerr << "reflection: hash collision between " << a.name << " and " << b.name << "\n";
+	}
+
+	return r;
+}
+
+size_t ProgramReflection::typeSize(uint type)
+{
+	switch (type)
+	{
+	case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL: return 4;
+	case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2: return 8;
+	case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3: return 12;
+	case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: return 16;
+	case GL_DOUBLE: return 8;
+	case GL_DOUBLE_VEC2: return 16;
+	case GL_DOUBLE_VEC3: return 24;
+	case GL_DOUBLE_VEC4: return 32;
+	case GL_FLOAT_MAT2: return 16;
+	case GL_FLOAT_MAT3: return 36;
+	case GL_FLOAT_MAT4: return 64;
+	case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2: return 24;
+	case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2: return 32;
+	case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3: return 48;
+	case GL_DOUBLE_MAT2: return 32;
+	case GL_DOUBLE_MAT3: return 72;
+	case GL_DOUBLE_MAT4: return 128;
+	case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT3x2: return 48;
+	case GL_DOUBLE_MAT2x4: case GL_DOUBLE_MAT4x2: return 64;
+	case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x3: return 96;
+	default: return 4;
+	}
+}
+
+const ProgramReflection::Resource* ProgramReflection::find(Kind kind, u32 hash) const
+{
+	auto found = std::lower_bound(begin(resources), end(resources), hash, [kind](const Resource &r, u32 h) {
+		return less(r, kind, h);
+	});
+	if (found == end(resources) || found->kind != kind || found->hash != hash)
+		return nullptr;
+	return &*found;
+}
+
+const ProgramReflection::Resource* ProgramReflection::find(Kind kind, std::string_view name) const
+{
+	auto hash = nameHash(name);
+	auto found = std::lower_bound(begin(resources), end(resources), hash, [kind](const Resource &r, u32 h) {
+		return less(r, kind, h);
+	});
+	for (; found != end(resources) && found->kind == kind && found->hash == hash; ++found)
+		if (found->name == name)
+			return &*found;
+	return nullptr;
+}
+
+int ProgramReflection::location(std::string_view name) const
+{
+	auto r = find(Kind::Uniform, name);
+	return r ? r->location : -1;
+}
+
+void ProgramReflection::print(std::ostream &out) const
+{
+	static const char *kinds[] = { "uniform", "uniform block", "storage block" };
+	for (const auto &r : resources)
+	{
+		out << "  " << kinds[static_cast<int>(r.kind)] << " " << r.name;
+		if (r.kind == Kind::Uniform)
+		{
+			if (r.arraySize > 1)
+				out << "[" << r.arraySize << "]";
+			if (r.location >= 0)
+				out << " @" << r.location;
+			else
+				out << " block " << r.block << " +" << r.offset;
+		}
+		else
+			out << " binding " << r.binding << ", " << r.dataSize << " bytes";
+		out << "\n";
+	}
+}
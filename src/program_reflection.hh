@@ -0,0 +1,59 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include <string_view>
+
+// FNV-1a, usable in constant expressions: constexpr auto MVP = nameHash("MVP");
+constexpr u32 nameHash(std::string_view name)
+{
+	u32 h = 2166136261u;
+	for (char c : name)
+	{
+		h ^= static_cast<u8>(c);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// Active uniforms, uniform blocks and storage blocks of a linked program,
+// queried once through the program interface API and kept in one flat table
+// sorted by kind and name hash.
+struct ProgramReflection
+{
+	enum class Kind : u8
+	{
+		Uniform,
+		UniformBlock,
+		StorageBlock,
+	};
+
+	struct Resource
+	{
+		Kind kind{ Kind::Uniform };
+		u32 hash{ 0 };
+		string name;
+		uint type{ 0 };      // GL_FLOAT_MAT4, ... for uniforms
+		int arraySize{ 1 };
+		int location{ -1 };  // -1 for members of a uniform block
+		int block{ -1 };     // owning uniform block for block members
+		int offset{ -1 };    // byte offset inside the owning block
+		int binding{ -1 };   // blocks only
+		int dataSize{ 0 };   // blocks only
+	};
+
+	vector<Resource> resources;
+
+	static ProgramReflection reflect(uint program);
+	// bytes of one element of a uniform as passed to glUniform*, samplers count as int
+	static size_t typeSize(uint type);
+
+	// by hash alone, a colliding name can match
+	const Resource* find(Kind kind, u32 hash) const;
+	// compares names among the entries sharing the hash
+	const Resource* find(Kind kind, std::string_view name) const;
+
+	// location of a default block uniform, -1 when not active
+	int location(std::string_view name) const;
+
+	void print(std::ostream &out) const;
+};
@@ -1,56 +1,304 @@
 #include "programs.hh"
 #include "log.hh"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <taskflow.hpp>
 
 
+Programs::Programs() = default;
+Programs::~Programs() = default;
+
+void Programs::attach(tf::Executor &shared)
+{
+	executor = &shared;
+}
+
 void Programs::load(const string &name)
 {
-	string basepath = string(SHADERS_PATH) + name;
-	string vertpath = basepath + "/vert.glsl";
-	string geompath = basepath + "/geom.glsl";
-	string fragpath = basepath + "/frag.glsl";
+	loadMany({ name });
+}
+
+void Programs::loadMany(const strings &names)
+{
+	auto sources = read(names);
+
+	// everything is submitted before the first status query so the driver
+	// can compile in parallel where it is able to
+	size_t first = compiling.size();
+	for (size_t i = 0; i < names.size(); ++i)
+		submit(names[i], sources[i]);
+
+	for (size_t i = first; i < compiling.size(); ++i)
+		finish(compiling[i]);
+	compiling.resize(first);
+}
+
+void Programs::loadAsync(const string &name)
+{
+	enableParallel();
+	submit(name, read({ name }).front());
+}
+
+void Programs::reload(const strings &names)
+{
+	enableParallel();
+	auto sources = read(names);
+	for (size_t i = 0; i < names.size(); ++i)
+		submit(names[i], sources[i], true);
+}
+
+strings Programs::reloadFiles(const strings &files)
+{
+	strings names;
+	for (const auto &file : files)
+		for (const auto &name : dependents(file))
+			if (std::find(begin(names), end(names), name) == end(names))
+				names.push_back(name);
+
+	if (!names.empty())
+		reload(names);
+	return names;
+}
 
-	struct Shader
+strings Programs::dependents(const string &file) const
+{
+	std::error_code ec;
+	auto path = std::filesystem::weakly_canonical(file, ec).string();
+
+	strings names;
+	for (const auto &entry : dependencies)
+		if (std::find(begin(entry.second), end(entry.second), path) != end(entry.second))
+			names.push_back(entry.first);
+
+	// a stage file created after load is no dependency yet:
+	// SHADERS_PATH/<program>/<stage>.glsl
+	auto rel = std::filesystem::relative(file, SHADERS_PATH, ec);
+	if (ec || rel.empty() || *rel.begin() == "..")
+		return names;
+
+	auto base = rel.begin()->string();
+	for (const auto &program : programs)
 	{
-		Files::ReadStatus vert;
-		Files::ReadStatus geom;
-		Files::ReadStatus frag;
-	} shader;
+		auto found = variants.find(program.first);
+		auto programBase = found != variants.end() ? found->second.base : program.first;
+		if (programBase == base && std::find(begin(names), end(names), program.first) == end(names))
+			names.push_back(program.first);
+	}
+	return names;
+}
 
-	tf::Executor executor;
+void Programs::enableParallel()
+{
+	if (parallelChecked)
+		return;
+	parallelChecked = true;
+	parallel = GLEW_KHR_parallel_shader_compile;
+	if (parallel)
+		gl.program.maxCompilerThreads(0xFFFFFFFF);
+}
+
+void Programs::update()
+{
+	for (auto it = begin(compiling); it != end(compiling);)
+	{
+		// without the extension the status query below blocks, finish everything at once
+		if (parallel && !gl.program.completed(it->id))
+		{
+			++it;
+			continue;
+		}
+		finish(*it);
+		it = compiling.erase(it);
+	}
+}
+
+bool Programs::ready(const string &program) const
+{
+	return linked.find(id(program)) != linked.end();
+}
+
+void Programs::fallback(const string &program)
+{
+	fallbackName = program;
+}
+
+vector<Programs::Sources> Programs::read(const strings &names)
+{
+	if (!executor)
+	{
+		ownExecutor = std::make_unique<tf::Executor>();
+		executor = ownExecutor.get();
+	}
+
+	vector<Sources> sources(names.size());
 	tf::Taskflow taskflow;
 
-	taskflow.emplace([&vertpath, &name, &shader]() {
-		if (Files::exists(vertpath))
-			shader.vert = Files::readText(vertpath);
-	});
-	taskflow.emplace([&geompath, &name, &shader]() {
-		if (Files::exists(geompath))
-			shader.geom = Files::readText(geompath);
-	});
-	taskflow.emplace([&fragpath, &name, &shader]() {
-		if (Files::exists(fragpath))
-			shader.frag = Files::readText(fragpath);
-	});
-
-	executor.run(taskflow).get();
-
-	if (Files::isLoaded(shader.vert))
-		addShader(GL_VERTEX_SHADER, name, "vert", Files::text(shader.vert));
-	if (Files::isLoaded(shader.geom))
-		addShader(GL_GEOMETRY_SHADER, name, "geom", Files::text(shader.geom));
-	if (Files::isLoaded(shader.frag))
-		addShader(GL_FRAGMENT_SHADER, name, "frag", Files::text(shader.frag));
-
-	create(name);
-	if (!link(name))
+	for (size_t i = 0; i < names.size(); ++i)
 	{
-		status(std::cerr, "program/" + name, false);
-		std::cerr << "-- Vert --\n" << compileLog(name + "/vert");
-		std::cerr << "-- Frag --\n" << compileLog(name + "/frag");
+		auto found = variants.find(names[i]);
+		auto base = found != variants.end() ? found->second.base : names[i];
+		auto defines = found != variants.end() ? found->second.defines : Defines{};
+		string basepath = string(SHADERS_PATH) + base;
+		auto &shader = sources[i];
+
+		taskflow.emplace([basepath, defines, &shader]() {
+			auto path = basepath + "/vert.glsl";
+			shader.hasVert = Files::exists(path);
+			if (shader.hasVert)
+				shader.vert = ShaderPreprocessor::process(path, defines);
+		});
+		taskflow.emplace([basepath, defines, &shader]() {
+			auto path = basepath + "/geom.glsl";
+			shader.hasGeom = Files::exists(path);
+			if (shader.hasGeom)
+				shader.geom = ShaderPreprocessor::process(path, defines);
+		});
+		taskflow.emplace([basepath, defines, &shader]() {
+			auto path = basepath + "/frag.glsl";
+			shader.hasFrag = Files::exists(path);
+			if (shader.hasFrag)
+				shader.frag = ShaderPreprocessor::process(path, defines);
+		});
 	}
+
+	executor->run(taskflow).get();
+	return sources;
+}
+
+string Programs::variant(const string &program, const Defines &defines)
+{
+	auto name = program + "[" + ShaderPreprocessor::key(defines) + "]";
+	if (variants.find(name) != variants.end())
+		return name;
+
+	variants[name] = { program, defines };
+	if (fallbackName.empty())
+		load(name);
 	else
-		status(std::cout, "program/" + name, true);
+		loadAsync(name);
+	return name;
+}
+
+bool Programs::submit(const string &name, const Sources &shader, bool swap)
+{
+	// a failed expansion keeps the old list too, an edit to any of them retries
+	auto &deps = dependencies[name];
+	if (!shader.failed())
+		deps.clear();
+	for (const auto *stage : { &shader.vert, &shader.geom, &shader.frag })
+		for (const auto &file : stage->dependencies)
+			if (std::find(begin(deps), end(deps), file) == end(deps))
+				deps.push_back(file);
+
+	// a stage that failed to preprocess must not be left out of the link,
+	// whatever is serving now (previous version or fallback) stays
+	if (shader.failed())
+	{
+		status(std::cerr, "program/" + name, false);
+		if (linked.find(id(name)) != linked.end())
+			std::cerr << "program/" << name << ": keeping the previous version\n";
+		return false;
+	}
+
+	// the program keeps serving until its replacement links
+	uint previous = 0;
+	if (swap)
+	{
+		previous = id(name);
+		// a newer edit supersedes a compile still in flight
+		for (auto it = begin(compiling); it != end(compiling);)
+		{
+			if (it->name != name)
+			{
+				++it;
+				continue;
+			}
+			if (it->id == previous)
+				previous = it->previous;
+			release(*it);
+			gl.program.del(it->id);
+			it = compiling.erase(it);
+		}
+	}
+
+	// expanded sources already carry the defines
+	auto key = ProgramCache::key({ shader.vert.source, shader.geom.source, shader.frag.source });
+	auto cached = gl.program.create();
+	if (cache.load(name, key, cached))
+	{
+		install(name, cached, previous);
+		status(std::cout, "program/" + name + " (cached)", true);
+		return false;
+	}
+	gl.program.del(cached);
+
+	Pending pending{ name, 0, key, previous, {}, {}, {} };
+	if (shader.vert.ok)
+		pending.vert = { addShader(GL_VERTEX_SHADER, shader.vert.source), shader.vert.dependencies };
+	if (shader.geom.ok)
+		pending.geom = { addShader(GL_GEOMETRY_SHADER, shader.geom.source), shader.geom.dependencies };
+	if (shader.frag.ok)
+		pending.frag = { addShader(GL_FRAGMENT_SHADER, shader.frag.source), shader.frag.dependencies };
+
+	// no status queries here, they would wait for the compiler
+	pending.id = create(pending);
+	gl.program.link(pending.id);
+	if (!previous)
+		programs[name] = pending.id;
+	compiling.push_back(std::move(pending));
+	return true;
+}
+
+bool Programs::finish(const Pending &pending)
+{
+	const auto &name = pending.name;
+	if (!link(pending))
+	{
+		status(std::cerr, "program/" + name, false);
+		std::cerr << "-- Vert --\n" << compileLog(pending.vert.shader) << fileTable(pending.vert.files);
+		if (pending.geom.shader)
+			std::cerr << "-- Geom --\n" << compileLog(pending.geom.shader) << fileTable(pending.geom.files);
+		std::cerr << "-- Frag --\n" << compileLog(pending.frag.shader) << fileTable(pending.frag.files);
+		release(pending);
+		if (pending.previous)
+		{
+			gl.program.del(pending.id);
+			std::cerr << "program/" << name << ": keeping the previous version\n";
+		}
+		return false;
+	}
+
+	release(pending);
+	install(name, pending.id, pending.previous);
+	cache.save(name, pending.key, pending.id);
+	status(std::cout, "program/" + name, true);
+	return true;
+}
+
+void Programs::install(const string &name, uint id, uint previous)
+{
+	vector<Handle> used;
+	auto replaced = linked.find(previous);
+	if (replaced != linked.end())
+		for (Handle h = 0; h < replaced->second.slots.size(); ++h)
+			if (replaced->second.slots[h].used)
+				used.push_back(h);
+
+	if (previous && previous != id)
+	{
+		if (inUseProg == previous)
+		{
+			inUseProg = 0;
+			current = nullptr;
+		}
+		linked.erase(previous);
+		gl.program.del(previous);
+	}
+
+	programs[name] = id;
+	auto &program = linked[id] = { name, ProgramReflection::reflect(id), {}, {} };
+	resolveAll(program, used);
 }
 
 uint Programs::use(const string &program)
@@ -59,15 +307,37 @@ uint Programs::use(const string &program)
 	if (found != programs.end())
 	{
 		auto id = found->second;
+		if (linked.find(id) == linked.end() && !fallbackName.empty() && program != fallbackName)
+			return use(fallbackName);
 		gl.program.use(id);
 		inUseProg = id;
+		auto reflected = linked.find(id);
+		current = reflected != linked.end() ? &reflected->second : nullptr;
 		return id;
 	}
+	// never loaded or failed before its first link
+	if (!fallbackName.empty() && program != fallbackName)
+		return use(fallbackName);
 	inUseProg = 0;
+	current = nullptr;
 
 	return 0;
 }
 
+uint Programs::id(const string &program) const
+{
+	auto found = programs.find(program);
+	return found != programs.end() ? found->second : 0;
+}
+
+uint Programs::readyId(const string &program) const
+{
+	auto id = this->id(program);
+	if (linked.find(id) != linked.end() || fallbackName.empty())
+		return id;
+	return this->id(fallbackName);
+}
+
 void Programs::reloadAll()
 {
 	strings progsToRecreate;
@@ -78,12 +348,21 @@ void Programs::reloadAll()
 		progsToRecreate.push_back(prog.first);
 		gl.program.del(prog.second);
 	}
-	uniformLocations.clear();
-	attachedShaders.clear();
-	shaders.clear();
+	// replacements in flight are not in programs yet
+	for (const auto &pending : compiling)
+	{
+		release(pending);
+		if (pending.previous)
+			gl.program.del(pending.id);
+	}
+	linked.clear();
+	inUseProg = 0;
+	current = nullptr;
+	compiling.clear();
+	// no dead ids for programs that fail this time
+	programs.clear();
 
-	for (const auto &prog : progsToRecreate)
-		load(prog);
+	loadMany(progsToRecreate);
 }
 
 void Programs::delAll()
@@ -92,51 +371,115 @@ void Programs::delAll()
 	for (const auto &prog : programs)
 		gl.program.del(prog.second);
 
-	uniformLocations.clear();
-	attachedShaders.clear();
-	shaders.clear();
+	// replacements in flight are not in programs yet
+	for (const auto &pending : compiling)
+	{
+		release(pending);
+		if (pending.previous)
+			gl.program.del(pending.id);
+	}
+	linked.clear();
+	current = nullptr;
+	compiling.clear();
 	programs.clear();
+	variants.clear();
+	dependencies.clear();
+}
+
+Programs::Handle Programs::handle(const string &name)
+{
+	auto found = handles.find(name);
+	if (found != handles.end())
+		return found->second;
+
+	Handle h = static_cast<Handle>(handleNames.size());
+	handleNames.push_back(name);
+	return handles[name] = h;
+}
+
+int Programs::location(Handle h)
+{
+	sync();
+	assert(inUseProg > 0);
+	return current ? resolve(*current, h).location : -1;
 }
 
-void Programs::uniform(const string &name, const mat4 &mat)
+int Programs::location(const string &program, Handle h)
 {
-	gl.uniform.set(uniformLocation(name), mat);
+	auto found = linked.find(id(program));
+	return found != linked.end() ? resolve(found->second, h).location : -1;
 }
 
-uint Programs::create(const string &program)
+const ProgramReflection* Programs::reflection(const string &program) const
+{
+	auto found = linked.find(id(program));
+	return found != linked.end() ? &found->second.reflection : nullptr;
+}
+
+void Programs::endFrame()
+{
+	last = frame;
+	frame = {};
+}
+
+bool Programs::bindBlock(const string &program, const string &block, uint binding)
+{
+	auto id = this->id(program);
+	auto index = id ? gl.program.blockIndex(id, block) : GL_INVALID_INDEX;
+	if (index == GL_INVALID_INDEX)
+	{
+		std::cerr << "program/" + program + ": no uniform block " + block + "\n";
+		return false;
+	}
+	gl.program.blockBinding(id, index, binding);
+	return true;
+}
+
+uint Programs::create(const Pending &pending)
 {
 	auto id = gl.program.create();
-	programs[program] = id;
-	for (const auto &id : attachedShaders[program])
-		gl.shader.attach(programs[program], id);
+	gl.program.parameter(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	for (const auto *stage : { &pending.vert, &pending.geom, &pending.frag })
+		if (stage->shader)
+			gl.shader.attach(id, stage->shader);
 
 	return id;
 }
 
-bool Programs::link(const string &program)
+bool Programs::link(const Pending &pending)
 {
-	auto id = programs[program];
-	gl.program.link(id);
-	use(program);
-	bool success = gl.program.getInt(id, GL_LINK_STATUS);
+	bool success = gl.program.getInt(pending.id, GL_LINK_STATUS);
 
+	// a linked program does not need its shaders any more
 	if (success)
-	{
-		// mark for deletion
-		for (const auto& id : attachedShaders[program])
-			gl.shader.detach(programs[program], id);
-
-		for (const auto& id : attachedShaders[program])
-			gl.shader.del(id);
-	}
-	gl.program.use(0);
+		for (const auto *stage : { &pending.vert, &pending.geom, &pending.frag })
+			if (stage->shader)
+				gl.shader.detach(pending.id, stage->shader);
 
 	return success;
 }
 
-string Programs::compileLog(const string &shader) const
+void Programs::release(const Pending &pending)
+{
+	// still attached ones go when their program is deleted
+	for (const auto *stage : { &pending.vert, &pending.geom, &pending.frag })
+		if (stage->shader)
+			gl.shader.del(stage->shader);
+}
+
+string Programs::fileTable(const strings &files)
+{
+	std::stringstream ss;
+	for (size_t i = 1; i < files.size(); ++i)
+		ss << "  " << i << ": " << files[i] << "\n";
+	return ss.str();
+}
+
+string Programs::compileLog(uint id) const
 {
-	auto id = shaders.at(shader);
+	if (!id)
+		return "missing\n";
+
 	auto type = gl.shader.getInt(id, GL_SHADER_TYPE);
 	auto maxLen = gl.shader.getInt(id, GL_INFO_LOG_LENGTH);
 
@@ -157,23 +500,96 @@ string Programs::compileLog(const string &shader) const
 	return ss.str();
 }
 
-uint Programs::addShader(uint type, const string &program, const string &shader, const string &source)
+uint Programs::addShader(uint type, const string &source)
 {
 	auto id = gl.shader.create(type);
 	gl.shader.source(id, source);
 	gl.shader.compile(id);
-	shaders[program + "/" + shader] = id;
-	attachedShaders[program].push_back(id);
 
 	return id;
 }
 
-int Programs::uniformLocation(const string & name)
+Programs::Slot& Programs::resolve(Linked &program, Handle h)
+{
+	if (h >= program.slots.size())
+		program.slots.resize(handleNames.size());
+
+	auto &slot = program.slots[h];
+	if (slot.location == Unresolved)
+		place(program, h);
+	if (!slot.used)
+	{
+		slot.used = true;
+		if (slot.location < 0)
+			std::cerr << "program/" << program.name << ": unknown uniform " << handleNames[h] << "\n";
+	}
+
+	return slot;
+}
+
+bool Programs::place(Linked &program, Handle h)
+{
+	auto &slot = program.slots[h];
+	auto r = program.reflection.find(ProgramReflection::Kind::Uniform, handleNames[h]);
+	slot.location = r ? r->location : -1;
+	if (slot.location < 0)
+		return false;
+
+	slot.offset = static_cast<u32>(program.values.size());
+	slot.size = static_cast<u32>(ProgramReflection::typeSize(r->type) * r->arraySize);
+	program.values.resize(program.values.size() + slot.size);
+	return true;
+}
+
+void Programs::resolveAll(Linked &program, const vector<Handle> &used)
+{
+	program.slots.resize(handleNames.size());
+	for (Handle h = 0; h < handleNames.size(); ++h)
+		place(program, h);
+
+	string unknown;
+	for (auto h : used)
+	{
+		program.slots[h].used = true;
+		if (program.slots[h].location < 0)
+			unknown += " " + handleNames[h];
+	}
+	if (!unknown.empty())
+		std::cerr << "program/" << program.name << ": unknown uniforms" << unknown << "\n";
+}
+
+void Programs::sync()
 {
+	auto bound = gl.state().program;
+	if (bound == GL::State::Unknown || bound == inUseProg)
+		return;
+
+	inUseProg = bound;
+	auto found = linked.find(bound);
+	current = found != linked.end() ? &found->second : nullptr;
+}
+
+int Programs::changed(Handle h, const void *data, size_t bytes)
+{
+	sync();
 	assert(inUseProg > 0);
-	auto foundLoc = uniformLocations[inUseProg].find(name);
-	if (foundLoc != end(uniformLocations[inUseProg]))
-		return foundLoc->second;
-	else
-		return uniformLocations[inUseProg][name] = gl.uniform.location(inUseProg, name);
+	if (!current)
+		return -1;
+
+	auto &slot = resolve(*current, h);
+	if (slot.location < 0)
+		return -1;
+
+	auto shadow = current->values.data() + slot.offset;
+	bytes = std::min(bytes, size_t(slot.size));
+	if (slot.written && std::memcmp(shadow, data, bytes) == 0)
+	{
+		++frame.skipped;
+		return -1;
+	}
+
+	std::memcpy(shadow, data, bytes);
+	slot.written = true;
+	++frame.issued;
+	return slot.location;
 }
@@ -2,32 +2,232 @@
 #include "types.hh"
 #include "files.hh"
 #include "gl.hh"
+#include "program_reflection.hh"
+#include "program_cache.hh"
+#include "shader_preprocessor.hh"
 #include <atomic>
 #include <future>
 #include <functional>
+#include <memory>
+#include <type_traits>
 
+namespace tf { class Executor; }
+
+// Uniform values are shadowed per program and only uploaded when they
+// change, so every uniform write to a program loaded here has to go through
+// uniform(); a raw gl.uniform.set() leaves the shadow stale. Programs bound
+// with gl.program.use() directly (render queue, command list replay) are
+// fine, uniform() follows the program GL::State has bound.
 class Programs
 {
+public:
+	// index of a uniform name, stable across programs and reloads
+	using Handle = uint;
+	using Defines = ShaderPreprocessor::Defines;
+
+	struct Counters
+	{
+		uint issued{ 0 };
+		uint skipped{ 0 };
+	};
+
 private:
-	unordered_map<string, uint> shaders;
+	static constexpr int Unresolved = -2;
+
+	// where a handle lives in a program and in its shadow copy
+	struct Slot
+	{
+		int location{ Unresolved };
+		u32 offset{ 0 };
+		u32 size{ 0 };
+		bool written{ false };
+		// set on first use, when an unknown name is reported
+		bool used{ false };
+	};
+
+	// preprocessed stages; a stage without a file is left out, one whose
+	// file exists but fails to preprocess fails the whole program
+	struct Sources
+	{
+		ShaderPreprocessor::Result vert;
+		ShaderPreprocessor::Result geom;
+		ShaderPreprocessor::Result frag;
+		bool hasVert{ false };
+		bool hasGeom{ false };
+		bool hasFrag{ false };
+
+		bool failed() const
+		{
+			return (hasVert && !vert.ok) || (hasGeom && !geom.ok) || (hasFrag && !frag.ok);
+		}
+	};
+
+	// a program built from another program's files with extra defines
+	struct Variant
+	{
+		string base;
+		Defines defines;
+	};
+
+	// compiled shader object, 0 for a stage without a file, and the source
+	// string numbers its #line directives use, for error logs
+	struct Stage
+	{
+		uint shader{ 0 };
+		strings files;
+	};
+
+	// linked but not yet checked, see update(); owns its shader objects
+	// until then, whether it is finished or superseded
+	struct Pending
+	{
+		string name;
+		uint id;
+		u64 key;
+		// replaced once id links, 0 on first load
+		uint previous;
+		Stage vert;
+		Stage geom;
+		Stage frag;
+	};
+
+	// reflection of a linked program and the last values uploaded to it
+	struct Linked
+	{
+		string name;
+		ProgramReflection reflection;
+		vector<Slot> slots;
+		vector<byte> values;
+	};
+
 	unordered_map<string, uint> programs;
-	unordered_map<string, vector<uint>> attachedShaders;
 	uint inUseProg{ 0 };
-	unordered_map<uint, unordered_map<string, uint>> uniformLocations;
+	unordered_map<uint, Linked> linked;
+	Linked *current{ nullptr };
+	unordered_map<string, Handle> handles;
+	vector<string> handleNames;
+	ProgramCache cache;
+	vector<Pending> compiling;
+	unordered_map<string, Variant> variants;
+	// every file each program was expanded from, for hot reload
+	unordered_map<string, strings> dependencies;
+	string fallbackName;
+	tf::Executor *executor{ nullptr };
+	std::unique_ptr<tf::Executor> ownExecutor;
+	bool parallel{ false };
+	bool parallelChecked{ false };
 	GL gl;
 
 public:
+	Programs();
+	~Programs();
+
+	// shares the app's worker pool, otherwise one is created on first load
+	void attach(tf::Executor &executor);
+
 	void load(const string &name);
+	// stage files of all programs are read in one taskflow run
+	void loadMany(const strings &names);
+	// returns right after submitting compile and link, update() finishes
+	// programs as the driver completes them
+	void loadAsync(const string &name);
+	void update();
+	bool ready(const string &program) const;
+	uint pending() const { return static_cast<uint>(compiling.size()); }
+
+	// recompiles in the background, each program is swapped in only if it
+	// links and keeps its old version otherwise; others are left untouched
+	void reload(const strings &names);
+	// reloads the programs depending on any of the files, returns their names
+	strings reloadFiles(const strings &files);
+	strings dependents(const string &file) const;
+	// used in place of programs that are still compiling or failed to link
+	void fallback(const string &program);
+
+	// name of the program compiled from program's files with defines, the
+	// variant is compiled on first request (in the background when a
+	// fallback is set) and shares everything else with ordinary programs
+	string variant(const string &program, const Defines &defines);
+	uint use(const string &program, const Defines &defines) { return use(variant(program, defines)); }
+
 	uint use(const string &program);
+	uint id(const string &program) const;
+	// id(), or the fallback's while the program is not ready
+	uint readyId(const string &program) const;
 	void reloadAll(); 
 	void delAll();
 
-	void uniform(const string &name, const mat4 &mat);
+	Handle handle(const string &name);
+	// location in the program in use; unknown names are reported once per
+	// program on first use, and at load time when a reload drops a uniform
+	// the previous version used
+	int location(Handle h);
+	int location(const string &program, Handle h);
+	const ProgramReflection* reflection(const string &program) const;
+
+	// any type GL::Uniform::set accepts: scalars, vectors, matrices, and
+	// spans of those for arrays; unchanged values are not uploaded again
+	template <typename T>
+	void uniform(Handle h, const T &value)
+	{
+		upload(h, &value, 1);
+	}
+
+	template <typename T>
+	void uniform(Handle h, Span<T> values)
+	{
+		upload(h, values.data(), static_cast<int>(values.size()));
+	}
+
+	void uniform(Handle h, bool value)
+	{
+		uniform(h, int(value));
+	}
+
+	template <typename T>
+	void uniform(const string &name, const T &value)
+	{
+		uniform(handle(name), value);
+	}
+
+	Counters frame;
+	Counters last;
+	void endFrame();
+	// for blocks declared without layout(binding = N)
+	bool bindBlock(const string &program, const string &block, uint binding);
 
 private:
-	uint create(const string &program);
-	bool link(const string &program);
-	string compileLog(const string &shader) const;
-	uint addShader(uint type, const string &program, const string &shader, const string &source);
-	int uniformLocation(const string &name);
+	vector<Sources> read(const strings &names);
+	bool submit(const string &name, const Sources &shader, bool swap = false);
+	bool finish(const Pending &pending);
+	void install(const string &name, uint id, uint previous);
+	void enableParallel();
+	uint create(const Pending &pending);
+	bool link(const Pending &pending);
+	// deletes the shader objects of a compile that is finished or dropped
+	void release(const Pending &pending);
+	string compileLog(uint shader) const;
+	// source string numbers of included files, as used in #line
+	static string fileTable(const strings &files);
+	uint addShader(uint type, const string &source);
+	Slot& resolve(Linked &program, Handle h);
+	// looks a handle up in the reflection, false when the program lacks it
+	bool place(Linked &program, Handle h);
+	// places every handle known so far; of those only the ones the previous
+	// version used are marked used and checked, the rest are reported on
+	// their first use with this program
+	void resolveAll(Linked &program, const vector<Handle> &used);
+	// catches up with binds made around use()
+	void sync();
+	// location to upload to, -1 when the value matches the shadow copy
+	int changed(Handle h, const void *data, size_t bytes);
+
+	template <typename T>
+	void upload(Handle h, const T *values, int count)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "uniform values are compared bytewise");
+		auto loc = changed(h, values, sizeof(T) * count);
+		if (loc >= 0)
+			gl.uniform.set(loc, values, count);
+	}
 };
@@ -0,0 +1,90 @@
+#include "quantize.hh"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+
+Quantize::Bounds Quantize::Bounds::of(Span<v3> positions)
+{
+	Bounds b;
+	if (positions.empty())
+		return b;
+
+	b.min = b.max = positions.data()[0];
+	for (size_t i = 1; i < positions.size(); ++i)
+	{
+		b.min = glm::min(b.min, positions.data()[i]);
+		b.max = glm::max(b.max, positions.data()[i]);
+	}
+	return b;
+}
+
+mat4 Quantize::Bounds::dequantize() const
+{
+	return glm::translate(mat4(1.0f), min) * glm::scale(mat4(1.0f), glm::max(max - min, v3(1e-20f)));
+}
+
+Half4 Quantize::positionHalf(const v3 &p)
+{
+	return { glm::packHalf1x16(p.x), glm::packHalf1x16(p.y), glm::packHalf1x16(p.z), glm::packHalf1x16(1.0f) };
+}
+
+Unorm16x4 Quantize::position(const v3 &p, const Bounds &bounds)
+{
+	auto extent = glm::max(bounds.max - bounds.min, v3(1e-20f));
+	auto n = glm::clamp((p - bounds.min) / extent, v3(0), v3(1));
+	auto q = glm::round(n * 65535.0f);
+	return { u16(q.x), u16(q.y), u16(q.z), 65535 };
+}
+
+Snorm16x2 Quantize::normalOct(const v3 &n)
+{
+	v3 a = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+	v2 e(a.x, a.y);
+	if (a.z < 0)
+	{
+		auto sx = a.x >= 0 ? 1.0f : -1.0f;
+		auto sy = a.y >= 0 ? 1.0f : -1.0f;
+		e = v2((1 - std::abs(a.y)) * sx, (1 - std::abs(a.x)) * sy);
+	}
+	auto q = glm::round(glm::clamp(e, v2(-1), v2(1)) * 32767.0f);
+	return { i16(q.x), i16(q.y) };
+}
+
+v3 Quantize::decodeOct(const Snorm16x2 &e)
+{
+	v2 f = glm::max(v2(e.x, e.y) / 32767.0f, v2(-1));
+	v3 n(f.x, f.y, 1 - std::abs(f.x) - std::abs(f.y));
+	if (n.z < 0)
+	{
+		auto sx = n.x >= 0 ? 1.0f : -1.0f;
+		auto sy = n.y >= 0 ? 1.0f : -1.0f;
+		n = v3((1 - std::abs(f.y)) * sx, (1 - std::abs(f.x)) * sy, n.z);
+	}
+	return glm::normalize(n);
+}
+
+Int1010102 Quantize::normal(const v3 &n, float w)
+{
+	return { glm::packSnorm3x10_1x2(v4(n, w)) };
+}
+
+Color8 Quantize::color(const v3 &c)
+{
+	return color(v4(c, 1));
+}
+
+Color8 Quantize::color(const v4 &c)
+{
+	auto q = glm::round(glm::clamp(c, v4(0), v4(1)) * 255.0f);
+	return { u8(q.r), u8(q.g), u8(q.b), u8(q.a) };
+}
+
+Unorm16x2 Quantize::uv(const v2 &uv)
+{
+	auto q = glm::round(glm::clamp(uv, v2(0), v2(1)) * 65535.0f);
+	return { u16(q.x), u16(q.y) };
+}
+
+Half2 Quantize::uvHalf(const v2 &uv)
+{
+	return { glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y) };
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "types.hh"
+#include "vertex_layout.hh"
+#include <type_traits>
+
+// packed attribute storage types, see AttrFormat specializations below
+struct Half2 { u16 x, y; };
+struct Half4 { u16 x, y, z, w; };
+struct Unorm16x2 { u16 x, y; };
+struct Unorm16x4 { u16 x, y, z, w; };
+struct Snorm16x2 { i16 x, y; };
+struct Int1010102 { u32 value; };
+struct Color8 { u8 r, g, b, a; };
+
+template <> struct AttrFormat<Half2> { static constexpr int size = 2; static constexpr uint type = GL_HALF_FLOAT; static constexpr bool normalized = false; static constexpr bool integer = false; };
+template <> struct AttrFormat<Half4> { static constexpr int size = 4; static constexpr uint type = GL_HALF_FLOAT; static constexpr bool normalized = false; static constexpr bool integer = false; };
+template <> struct AttrFormat<Unorm16x2> { static constexpr int size = 2; static constexpr uint type = GL_UNSIGNED_SHORT; static constexpr bool normalized = true; static constexpr bool integer = false; };
+template <> struct AttrFormat<Unorm16x4> { static constexpr int size = 4; static constexpr uint type = GL_UNSIGNED_SHORT; static constexpr bool normalized = true; static constexpr bool integer = false; };
+template <> struct AttrFormat<Snorm16x2> { static constexpr int size = 2; static constexpr uint type = GL_SHORT; static constexpr bool normalized = true; static constexpr bool integer = false; };
+template <> struct AttrFormat<Int1010102> { static constexpr int size = 4; static constexpr uint type = GL_INT_2_10_10_10_REV; static constexpr bool normalized = true; static constexpr bool integer = false; };
+template <> struct AttrFormat<Color8> { static constexpr int size = 4; static constexpr uint type = GL_UNSIGNED_BYTE; static constexpr bool normalized = true; static constexpr bool integer = false; };
+
+// Conversions from full float attributes to the packed types above.
+class Quantize
+{
+public:
+	struct Bounds
+	{
+		v3 min{ 0 };
+		v3 max{ 0 };
+
+		static Bounds of(Span<v3> positions);
+		// maps unorm16 positions back to object space, fold into MODEL
+		mat4 dequantize() const;
+	};
+
+	static Half4 positionHalf(const v3 &p);
+	static Unorm16x4 position(const v3 &p, const Bounds &bounds);
+
+	// octahedral encoding, decode in GLSL with:
+	//   vec3 n = vec3(e, 1 - abs(e.x) - abs(e.y));
+	//   if (n.z < 0) n.xy = (1 - abs(n.yx)) * sign(n.xy);
+	//   n = normalize(n);
+	static Snorm16x2 normalOct(const v3 &n);
+	static v3 decodeOct(const Snorm16x2 &e);
+	// w carries the tangent handedness
+	static Int1010102 normal(const v3 &n, float w = 0);
+
+	static Color8 color(const v3 &c);
+	static Color8 color(const v4 &c);
+	static Unorm16x2 uv(const v2 &uv);
+	static Half2 uvHalf(const v2 &uv);
+
+	// runs a per-vertex packing function over a whole mesh
+	template <typename In, typename F>
+	static auto vertices(const vector<In> &in, F &&pack)
+	{
+		using Out = std::invoke_result_t<F, const In &>;
+		static_assert(std::is_trivially_copyable_v<Out>, "packed vertices must be trivially copyable");
+		vector<Out> out;
+		out.reserve(in.size());
+		for (const auto &v : in)
+			out.push_back(pack(v));
+		return out;
+	}
+};
@@ -0,0 +1,112 @@
+#include "range_allocator.hh"
+#include <cassert>
+
+RangeAllocator::RangeAllocator(size_t capacity)
+{
+	reset(capacity);
+}
+
+void RangeAllocator::reset(size_t _capacity)
+{
+	capacity = _capacity;
+	freeByOffset.clear();
+	freeBySize.clear();
+	used.clear();
+	if (capacity > 0)
+		insertFree(0, capacity);
+}
+
+size_t RangeAllocator::alloc(size_t size)
+{
+	if (size == 0)
+		return Invalid;
+
+	auto best = freeBySize.lower_bound(size);
+	if (best == end(freeBySize))
+		return Invalid;
+
+	auto offset = best->second;
+	auto blockSize = best->first;
+	eraseFree(freeByOffset.find(offset));
+
+	if (blockSize > size)
+		insertFree(offset + size, blockSize - size);
+
+	used[offset] = size;
+	return offset;
+}
+
+void RangeAllocator::free(size_t offset)
+{
+	auto found = used.find(offset);
+	assert(found != end(used));
+	if (found == end(used))
+		return;
+
+	auto size = found->second;
+	used.erase(found);
+
+	// merge with the following block
+	auto next = freeByOffset.find(offset + size);
+	if (next != end(freeByOffset))
+	{
+		size += next->second;
+		eraseFree(next);
+	}
+
+	// merge with the preceding block
+	auto prev = freeByOffset.lower_bound(offset);
+	if (prev != begin(freeByOffset))
+	{
+		--prev;
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			eraseFree(prev);
+		}
+	}
+
+	insertFree(offset, size);
+}
+
+size_t RangeAllocator::size(size_t offset) const
+{
+	auto found = used.find(offset);
+	return found != end(used) ? found->second : 0;
+}
+
+RangeAllocator::Stats RangeAllocator::stats() const
+{
+	Stats s;
+	s.capacity = capacity;
+	s.freeBlocks = freeByOffset.size();
+	s.allocations = used.size();
+	for (const auto &block : freeByOffset)
+		s.free += block.second;
+	s.used = capacity - s.free;
+	if (!freeBySize.empty())
+		s.largestFree = freeBySize.rbegin()->first;
+
+	return s;
+}
+
+void RangeAllocator::insertFree(size_t offset, size_t size)
+{
+	freeByOffset[offset] = size;
+	freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::eraseFree(std::map<size_t, size_t>::iterator it)
+{
+	auto range = freeBySize.equal_range(it->second);
+	for (auto s = range.first; s != range.second; ++s)
+	{
+		if (s->second == it->first)
+		{
+			freeBySize.erase(s);
+			break;
+		}
+	}
+	freeByOffset.erase(it);
+}
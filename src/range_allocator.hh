@@ -0,0 +1,46 @@
+#pragma once
+#include "types.hh"
+#include <map>
+
+// Offset allocator over an abstract [0, capacity) range. Free blocks are
+// indexed by offset (for coalescing) and by size (for best fit lookups).
+class RangeAllocator
+{
+public:
+	static constexpr size_t Invalid = ~size_t(0);
+
+	struct Stats
+	{
+		size_t capacity{ 0 };
+		size_t used{ 0 };
+		size_t free{ 0 };
+		size_t largestFree{ 0 };
+		size_t freeBlocks{ 0 };
+		size_t allocations{ 0 };
+
+		// 0 when all free space is one block, approaching 1 when it is scattered
+		float fragmentation() const
+		{
+			return free > 0 ? 1.0f - float(largestFree) / float(free) : 0.0f;
+		}
+	};
+
+	explicit RangeAllocator(size_t capacity = 0);
+
+	void reset(size_t capacity);
+	size_t alloc(size_t size);
+	void free(size_t offset);
+	size_t size(size_t offset) const;
+
+	Stats stats() const;
+	const std::map<size_t, size_t>& allocations() const { return used; }
+
+private:
+	void insertFree(size_t offset, size_t size);
+	void eraseFree(std::map<size_t, size_t>::iterator it);
+
+	size_t capacity{ 0 };
+	std::map<size_t, size_t> freeByOffset;
+	std::multimap<size_t, size_t> freeBySize;
+	std::map<size_t, size_t> used;
+};
@@ -0,0 +1,97 @@
+#include "render_queue.hh"
+#include "index_buffer.hh"
+#include <algorithm>
+
+void RenderQueue::begin(float _farDepth)
+{
+	farDepth = _farDepth > 0 ? _farDepth : 1;
+	packets.clear();
+	keys.clear();
+}
+
+void RenderQueue::push(const DrawPacket &packet)
+{
+	packets.push_back(packet);
+	keys.push_back(key(packet, farDepth));
+}
+
+u64 RenderQueue::key(const DrawPacket &p, float farDepth)
+{
+	u64 depth = static_cast<u64>(std::clamp(p.depth / farDepth, 0.0f, 1.0f) * 0xFFFFFF);
+	u64 state = (u64(p.program & 0xFFF) << 22) | (u64(p.vertexArray & 0x3FF) << 12) | u64(p.material & 0xFFF);
+	u64 pass = u64(p.pass & 0xF) << 60;
+
+	if (!p.translucent)
+		return pass | (state << 24) | depth;
+
+	return pass | (1ull << 59) | ((0xFFFFFF - depth) << 34) | state;
+}
+
+// LSD radix sort, 8 bits per pass; passes whose byte is the same for every
+// key are skipped, which is most of them for small scenes
+void RenderQueue::sort()
+{
+	const size_t n = keys.size();
+	order.resize(n);
+	for (size_t i = 0; i < n; ++i)
+		order[i] = static_cast<u32>(i);
+	keysTmp.resize(n);
+	orderTmp.resize(n);
+
+	for (uint shift = 0; shift < 64; shift += 8)
+	{
+		size_t counts[256] = {};
+		for (auto k : keys)
+			++counts[(k >> shift) & 0xFF];
+		if (n == 0 || counts[(keys[0] >> shift) & 0xFF] == n)
+			continue;
+
+		size_t offsets[256];
+		size_t sum = 0;
+		for (int b = 0; b < 256; ++b)
+		{
+			offsets[b] = sum;
+			sum += counts[b];
+		}
+		for (size_t i = 0; i < n; ++i)
+		{
+			auto dst = offsets[(keys[i] >> shift) & 0xFF]++;
+			keysTmp[dst] = keys[i];
+			orderTmp[dst] = order[i];
+		}
+		keys.swap(keysTmp);
+		order.swap(orderTmp);
+	}
+}
+
+void RenderQueue::submit(const std::function<void(const DrawPacket &)> &perDraw)
+{
+	Stats stats;
+	uint program = ~0u;
+	uint vertexArray = ~0u;
+
+	for (auto i : order)
+	{
+		const auto &p = packets[i];
+		if (p.program != program)
+		{
+			gl.program.use(p.program);
+			program = p.program;
+			++stats.programSwitches;
+		}
+		if (p.vertexArray != vertexArray)
+		{
+			gl.vertexArray.bind(p.vertexArray);
+			vertexArray = p.vertexArray;
+			++stats.vertexArraySwitches;
+		}
+		if (perDraw)
+			perDraw(p);
+
+		auto offset = IndexBuffer::typeSize(p.indexType) * p.firstIndex;
+		gl.draw.elementsBaseVertex(GL_TRIANGLES, p.indexCount, p.baseVertex, offset, p.indexType);
+		++stats.draws;
+	}
+
+	lastStats = stats;
+}
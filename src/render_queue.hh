@@ -0,0 +1,58 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include <functional>
+
+struct DrawPacket
+{
+	uint program{ 0 };
+	uint vertexArray{ 0 };
+	uint material{ 0 };
+	u32 firstIndex{ 0 };
+	u32 indexCount{ 0 };
+	i32 baseVertex{ 0 };
+	uint indexType{ GL_UNSIGNED_INT };
+	// caller's handle for per draw data (transform, material params...)
+	u32 object{ 0 };
+	// view space distance
+	float depth{ 0 };
+	uint pass{ 0 };
+	bool translucent{ false };
+};
+
+// Collects draw packets for a frame, orders them by a 64-bit sort key and
+// submits them with as few program and vertex array switches as possible.
+//
+// key, most significant first:
+//   opaque:      pass:4 | 0:1 | program:12 | vao:10 | material:12 | depth:24
+//   translucent: pass:4 | 1:1 | ~depth:24  | program:12 | vao:10 | material:12
+// ids wider than their field only weaken batching, packets keep the full ids
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		uint draws{ 0 };
+		uint programSwitches{ 0 };
+		uint vertexArraySwitches{ 0 };
+	};
+
+	void begin(float farDepth);
+	void push(const DrawPacket &packet);
+	void sort();
+	void submit(const std::function<void(const DrawPacket &)> &perDraw = nullptr);
+
+	static u64 key(const DrawPacket &packet, float farDepth);
+	const Stats& stats() const { return lastStats; }
+	size_t size() const { return packets.size(); }
+
+private:
+	GL gl;
+	float farDepth{ 1 };
+	vector<DrawPacket> packets;
+	vector<u64> keys;
+	vector<u32> order;
+	vector<u64> keysTmp;
+	vector<u32> orderTmp;
+	Stats lastStats;
+};
@@ -0,0 +1,84 @@
+#include "samplers.hh"
+#include <algorithm>
+#include <cstring>
+
+bool SamplerDesc::operator==(const SamplerDesc &o) const
+{
+	return minFilter == o.minFilter && magFilter == o.magFilter &&
+		wrapS == o.wrapS && wrapT == o.wrapT && wrapR == o.wrapR &&
+		anisotropy == o.anisotropy && lodBias == o.lodBias &&
+		compareMode == o.compareMode && compareFunc == o.compareFunc;
+}
+
+size_t SamplerDesc::hash() const
+{
+	// field by field, padding bytes are not part of the description
+	u64 h = 14695981039346656037ull;
+	auto mix = [&h](u32 v) {
+		for (int i = 0; i < 4; ++i)
+		{
+			h ^= (v >> (i * 8)) & 0xFF;
+			h *= 1099511628211ull;
+		}
+	};
+	auto bits = [](float f) {
+		u32 v;
+		std::memcpy(&v, &f, sizeof(v));
+		return v;
+	};
+
+	mix(minFilter);
+	mix(magFilter);
+	mix(wrapS);
+	mix(wrapT);
+	mix(wrapR);
+	mix(bits(anisotropy));
+	mix(bits(lodBias));
+	mix(compareMode);
+	mix(compareFunc);
+	return static_cast<size_t>(h);
+}
+
+float Samplers::maxAnisotropy()
+{
+	if (anisotropyLimit < 0)
+		anisotropyLimit = GLEW_EXT_texture_filter_anisotropic ? gl.getFloat(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT) : 1.0f;
+	return anisotropyLimit;
+}
+
+uint Samplers::get(const SamplerDesc &requested)
+{
+	// clamp first so requests that end up equal share one object
+	auto desc = requested;
+	desc.anisotropy = std::clamp(desc.anisotropy, 1.0f, maxAnisotropy());
+
+	auto found = cache.find(desc);
+	if (found != cache.end())
+		return found->second;
+
+	auto s = gl.sampler.create();
+	gl.sampler.parameter(s, GL_TEXTURE_MIN_FILTER, int(desc.minFilter));
+	gl.sampler.parameter(s, GL_TEXTURE_MAG_FILTER, int(desc.magFilter));
+	gl.sampler.parameter(s, GL_TEXTURE_WRAP_S, int(desc.wrapS));
+	gl.sampler.parameter(s, GL_TEXTURE_WRAP_T, int(desc.wrapT));
+	gl.sampler.parameter(s, GL_TEXTURE_WRAP_R, int(desc.wrapR));
+	gl.sampler.parameter(s, GL_TEXTURE_LOD_BIAS, desc.lodBias);
+	gl.sampler.parameter(s, GL_TEXTURE_COMPARE_MODE, int(desc.compareMode));
+	gl.sampler.parameter(s, GL_TEXTURE_COMPARE_FUNC, int(desc.compareFunc));
+	if (GLEW_EXT_texture_filter_anisotropic)
+		gl.sampler.parameter(s, GL_TEXTURE_MAX_ANISOTROPY_EXT, desc.anisotropy);
+
+	return cache[desc] = s;
+}
+
+void Samplers::bind(uint unit, const SamplerDesc &desc)
+{
+	gl.sampler.bind(unit, get(desc));
+}
+
+void Samplers::del()
+{
+	for (const auto &entry : cache)
+		gl.sampler.del(entry.second);
+	cache.clear();
+}
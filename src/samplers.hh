@@ -0,0 +1,43 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+
+struct SamplerDesc
+{
+	uint minFilter{ GL_LINEAR_MIPMAP_LINEAR };
+	uint magFilter{ GL_LINEAR };
+	uint wrapS{ GL_REPEAT };
+	uint wrapT{ GL_REPEAT };
+	uint wrapR{ GL_REPEAT };
+	float anisotropy{ 1.0f };
+	float lodBias{ 0.0f };
+	uint compareMode{ GL_NONE };
+	uint compareFunc{ GL_LEQUAL };
+
+	bool operator==(const SamplerDesc &o) const;
+	size_t hash() const;
+
+	struct Hash
+	{
+		size_t operator()(const SamplerDesc &d) const { return d.hash(); }
+	};
+};
+
+// Shared sampler objects, one per distinct description, so textures never
+// carry their own filtering state. Binds go through GL::Sampler which skips
+// units that already hold the requested sampler.
+class Samplers
+{
+public:
+	uint get(const SamplerDesc &desc);
+	void bind(uint unit, const SamplerDesc &desc);
+	void del();
+
+	size_t size() const { return cache.size(); }
+	float maxAnisotropy();
+
+private:
+	GL gl;
+	std::unordered_map<SamplerDesc, uint, SamplerDesc::Hash> cache;
+	float anisotropyLimit{ -1.0f };
+};
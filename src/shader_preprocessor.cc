@@ -0,0 +1,395 @@
+#include "shader_preprocessor.hh"
+#include "files.hh"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+struct ShaderPreprocessor::Context
+{
+	const Defines &defines;
+	Result &result;
+	// injected and #define'd macros, for evaluating conditions
+	std::map<string, string> macros;
+	std::set<string> once;
+	std::ostringstream out;
+	int depth{ 0 };
+	bool versionSeen{ false };
+
+	Context(const Defines &defines, Result &result) : defines(defines), result(result), macros(begin(defines), end(defines)) {}
+};
+
+namespace
+{
+	const int MaxDepth = 32;
+
+	string canonicalPath(const fs::path &path)
+	{
+		std::error_code ec;
+		auto c = fs::weakly_canonical(path, ec);
+		return (ec ? path : c).string();
+	}
+
+	string trimLeft(const string &line)
+	{
+		auto first = line.find_first_not_of(" \t");
+		return first == string::npos ? string() : line.substr(first);
+	}
+
+	// "#  include" and "#include" are the same directive
+	bool directive(const string &trimmed, const char *name, string &rest)
+	{
+		if (trimmed.empty() || trimmed[0] != '#')
+			return false;
+		auto word = trimLeft(trimmed.substr(1));
+		auto len = std::char_traits<char>::length(name);
+		if (word.compare(0, len, name) != 0 || (word.size() > len && (std::isalnum(static_cast<u8>(word[len])) || word[len] == '_')))
+			return false;
+		rest = trimLeft(word.substr(len));
+		return true;
+	}
+
+	// the line without comments, inBlock carries an open /* */ to the next line
+	string code(const string &line, bool &inBlock)
+	{
+		string out;
+		for (size_t i = 0; i < line.size(); ++i)
+		{
+			if (inBlock)
+			{
+				if (line.compare(i, 2, "*/") == 0)
+				{
+					inBlock = false;
+					++i;
+				}
+				continue;
+			}
+			if (line.compare(i, 2, "//") == 0)
+				break;
+			if (line.compare(i, 2, "/*") == 0)
+			{
+				inBlock = true;
+				out += ' ';
+				++i;
+				continue;
+			}
+			out += line[i];
+		}
+		return out;
+	}
+
+	string word(const string &text)
+	{
+		size_t end = 0;
+		while (end < text.size() && (std::isalnum(static_cast<u8>(text[end])) || text[end] == '_'))
+			++end;
+		return text.substr(0, end);
+	}
+
+	enum class Live : u8 { Yes, No, Unknown };
+
+	// one #if ... #endif group
+	struct Group
+	{
+		// of the enclosing groups
+		Live outer;
+		Live branch;
+		// an earlier branch was taken, or might have been
+		bool taken;
+		bool maybeTaken;
+	};
+
+	Live live(const vector<Group> &groups)
+	{
+		if (groups.empty())
+			return Live::Yes;
+		const auto &g = groups.back();
+		if (g.outer == Live::No || g.branch == Live::No)
+			return Live::No;
+		if (g.outer == Live::Unknown || g.branch == Live::Unknown)
+			return Live::Unknown;
+		return Live::Yes;
+	}
+
+	Live integer(const string &value)
+	{
+		auto v = trimLeft(value);
+		while (!v.empty() && std::isspace(static_cast<u8>(v.back())))
+			v.pop_back();
+		if (v.empty() || v.find_first_not_of("0123456789") != string::npos)
+			return Live::Unknown;
+		return v.find_first_not_of('0') != string::npos ? Live::Yes : Live::No;
+	}
+
+	// integer literals, macros defined to one, [!]defined(X) and [!]defined X;
+	// anything else is left to the GLSL compiler
+	Live evaluate(string expr, const std::map<string, string> &macros)
+	{
+		expr = trimLeft(expr);
+		while (!expr.empty() && std::isspace(static_cast<u8>(expr.back())))
+			expr.pop_back();
+
+		bool negate = !expr.empty() && expr[0] == '!';
+		if (negate)
+			expr = trimLeft(expr.substr(1));
+
+		Live result = Live::Unknown;
+		if (expr.compare(0, 7, "defined") == 0)
+		{
+			auto rest = trimLeft(expr.substr(7));
+			bool paren = !rest.empty() && rest[0] == '(';
+			if (paren)
+				rest = trimLeft(rest.substr(1));
+			auto name = word(rest);
+			rest = trimLeft(rest.substr(name.size()));
+			if (!name.empty() && rest == (paren ? ")" : ""))
+				result = macros.count(name) ? Live::Yes : Live::No;
+		}
+		else if (!expr.empty() && std::isdigit(static_cast<u8>(expr[0])))
+			result = integer(expr);
+		else if (!expr.empty() && word(expr) == expr)
+		{
+			auto found = macros.find(expr);
+			result = found == macros.end() ? Live::No : integer(found->second);
+		}
+
+		if (negate && result != Live::Unknown)
+			result = result == Live::Yes ? Live::No : Live::Yes;
+		return result;
+	}
+}
+
+string ShaderPreprocessor::key(const Defines &defines)
+{
+	auto sorted = defines;
+	std::sort(begin(sorted), end(sorted));
+
+	string k;
+	for (const auto &d : sorted)
+	{
+		if (!k.empty())
+			k += ';';
+		k += d.first;
+		if (!d.second.empty())
+			k += "=" + d.second;
+	}
+	return k;
+}
+
+u64 ShaderPreprocessor::hash(const string &text)
+{
+	u64 h = 14695981039346656037ull;
+	for (char c : text)
+	{
+		h ^= static_cast<u8>(c);
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+ShaderPreprocessor::Result ShaderPreprocessor::process(const string &path, const Defines &defines)
+{
+	auto read = Files::readText(path);
+	if (!Files::isLoaded(read))
+	{
+		std::cerr << "preprocessor: cannot read " << path << "\n";
+		return {};
+	}
+	return process(path, Files::text(read), defines);
+}
+
+ShaderPreprocessor::Result ShaderPreprocessor::process(const string &path, const string &source, const Defines &defines)
+{
+	Result result;
+	Context ctx(defines, result);
+	result.dependencies.push_back(canonicalPath(path));
+
+	if (!expand(path, source, 0, ctx))
+		return result;
+
+	result.source = ctx.out.str();
+	if (!ctx.versionSeen)
+	{
+		// no #version to follow, defines go first
+		std::ostringstream head;
+		for (const auto &d : defines)
+			head << "#define " << d.first << " " << d.second << "\n";
+		head << "#line 1 0\n";
+		result.source = head.str() + result.source;
+	}
+
+	result.hash = hash(result.source);
+	result.ok = true;
+	return result;
+}
+
+bool ShaderPreprocessor::expand(const string &path, const string &source, int index, Context &ctx)
+{
+	if (++ctx.depth > MaxDepth)
+	{
+		std::cerr << "preprocessor: includes nested too deep at " << path << ", missing #pragma once?\n";
+		return false;
+	}
+
+	std::istringstream in(source);
+	string line;
+	int lineNo = 0;
+	bool inComment = false;
+	vector<Group> groups;
+	auto where = [&path, &lineNo]() { return path + "(" + std::to_string(lineNo) + "): "; };
+
+	while (std::getline(in, line))
+	{
+		++lineNo;
+		auto trimmed = trimLeft(code(line, inComment));
+		string rest;
+
+		// conditions are tracked so includes follow the defines, the lines
+		// themselves are passed on for the GLSL compiler to evaluate again
+		bool conditional = true;
+		bool ifdef = directive(trimmed, "ifdef", rest);
+		bool isElse = !ifdef && directive(trimmed, "else", rest);
+		if (ifdef || directive(trimmed, "ifndef", rest))
+		{
+			bool defined = ctx.macros.count(word(rest)) != 0;
+			auto branch = defined == ifdef ? Live::Yes : Live::No;
+			groups.push_back({ live(groups), branch, branch == Live::Yes, false });
+		}
+		else if (directive(trimmed, "if", rest))
+		{
+			auto branch = evaluate(rest, ctx.macros);
+			groups.push_back({ live(groups), branch, branch == Live::Yes, branch == Live::Unknown });
+		}
+		else if (isElse || directive(trimmed, "elif", rest))
+		{
+			if (groups.empty())
+			{
+				std::cerr << where() << "#else or #elif without #if\n";
+				return false;
+			}
+			auto &g = groups.back();
+			auto branch = isElse ? Live::Yes : evaluate(rest, ctx.macros);
+			if (g.taken)
+				branch = Live::No;
+			else if (g.maybeTaken && branch == Live::Yes)
+				branch = Live::Unknown;
+			g.branch = branch;
+			g.taken = g.taken || branch == Live::Yes;
+			g.maybeTaken = g.maybeTaken || branch == Live::Unknown;
+		}
+		else if (directive(trimmed, "endif", rest))
+		{
+			if (groups.empty())
+			{
+				std::cerr << where() << "#endif without #if\n";
+				return false;
+			}
+			groups.pop_back();
+		}
+		else
+			conditional = false;
+
+		if (conditional)
+		{
+			ctx.out << line << "\n";
+			continue;
+		}
+
+		auto state = live(groups);
+		if (state == Live::No)
+		{
+			// an #include here is skipped by the compiler too, but not all
+			// drivers accept the directive at all
+			ctx.out << (directive(trimmed, "include", rest) ? "" : line) << "\n";
+			continue;
+		}
+
+		if (directive(trimmed, "define", rest))
+		{
+			auto name = word(rest);
+			auto value = rest.substr(name.size());
+			// function-like macros never hold a plain integer
+			ctx.macros[name] = !value.empty() && value[0] == '(' ? string("()") : value;
+		}
+		else if (directive(trimmed, "undef", rest))
+			ctx.macros.erase(word(rest));
+
+		if (!ctx.versionSeen && index == 0 && directive(trimmed, "version", rest))
+		{
+			ctx.versionSeen = true;
+			ctx.out << line << "\n";
+			for (const auto &d : ctx.defines)
+				ctx.out << "#define " << d.first << " " << d.second << "\n";
+			ctx.out << "#line " << lineNo + 1 << " " << index << "\n";
+			continue;
+		}
+
+		if (directive(trimmed, "pragma", rest) && rest.compare(0, 4, "once") == 0)
+		{
+			ctx.once.insert(ctx.result.dependencies[index]);
+			ctx.out << "\n";
+			continue;
+		}
+
+		if (!directive(trimmed, "include", rest))
+		{
+			ctx.out << line << "\n";
+			continue;
+		}
+
+		if (state == Live::Unknown)
+		{
+			std::cerr << where() << "#include under a condition the preprocessor cannot evaluate, use #ifdef or defined()\n";
+			return false;
+		}
+
+		auto open = rest.find('"');
+		auto close = rest.find('"', open + 1);
+		if (open == string::npos || close == string::npos)
+		{
+			std::cerr << where() << "malformed #include\n";
+			return false;
+		}
+		auto name = rest.substr(open + 1, close - open - 1);
+
+		auto local = fs::path(path).parent_path() / name;
+		auto file = canonicalPath(Files::exists(local.string()) ? local : fs::path(SHADERS_PATH) / name);
+
+		if (ctx.once.count(file))
+		{
+			ctx.out << "\n";
+			continue;
+		}
+
+		auto read = Files::readText(file);
+		if (!Files::isLoaded(read))
+		{
+			std::cerr << where() << "cannot include " << name << "\n";
+			return false;
+		}
+
+		auto &deps = ctx.result.dependencies;
+		auto found = std::find(begin(deps), end(deps), file);
+		int child = static_cast<int>(found - begin(deps));
+		if (found == end(deps))
+			deps.push_back(file);
+
+		ctx.out << "#line 1 " << child << "\n";
+		if (!expand(file, Files::text(read), child, ctx))
+			return false;
+		ctx.out << "#line " << lineNo + 1 << " " << index << "\n";
+	}
+
+	if (!groups.empty())
+	{
+		std::cerr << path << ": unterminated #if\n";
+		return false;
+	}
+
+	--ctx.depth;
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "types.hh"
+#include <utility>
+
+// Expands #include "file" (relative to the including file, then to
+// SHADERS_PATH) and injects a define set right after #version. Files marked
+// with #pragma once are included once; classic #ifndef guards are left to
+// the GLSL compiler. #line directives use the index into dependencies as
+// source string number, so compile errors point back to the right file.
+// Includes follow #ifdef/#ifndef/#if/#elif/#else against the injected and
+// #define'd macros and are ignored inside comments; conditions beyond
+// integers and [!]defined(X) fail the expansion if they hold an #include.
+class ShaderPreprocessor
+{
+public:
+	using Defines = vector<std::pair<string, string>>;
+
+	struct Result
+	{
+		bool ok{ false };
+		string source;
+		u64 hash{ 0 };
+		// canonical paths, the expanded file itself first
+		strings dependencies;
+	};
+
+	static Result process(const string &path, const Defines &defines);
+	static Result process(const string &path, const string &source, const Defines &defines);
+
+	// sorted "A;B=1" form, equal for equal define sets
+	static string key(const Defines &defines);
+	static u64 hash(const string &text);
+
+private:
+	struct Context;
+	static bool expand(const string &path, const string &source, int index, Context &ctx);
+};
@@ -0,0 +1,312 @@
+#include "simplifier.hh"
+#include <taskflow.hpp>
+#include <algorithm>
+#include <unordered_set>
+
+namespace
+{
+	struct Quadric
+	{
+		double a2{ 0 }, ab{ 0 }, ac{ 0 }, ad{ 0 };
+		double b2{ 0 }, bc{ 0 }, bd{ 0 };
+		double c2{ 0 }, cd{ 0 };
+		double d2{ 0 };
+		// sum of plane weights, eval() / weight is a squared distance
+		double w{ 0 };
+
+		static Quadric plane(const glm::dvec3 &n, double d, double w)
+		{
+			Quadric q;
+			q.w = w;
+			q.a2 = w * n.x * n.x; q.ab = w * n.x * n.y; q.ac = w * n.x * n.z; q.ad = w * n.x * d;
+			q.b2 = w * n.y * n.y; q.bc = w * n.y * n.z; q.bd = w * n.y * d;
+			q.c2 = w * n.z * n.z; q.cd = w * n.z * d;
+			q.d2 = w * d * d;
+			return q;
+		}
+
+		void add(const Quadric &o)
+		{
+			a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+			b2 += o.b2; bc += o.bc; bd += o.bd;
+			c2 += o.c2; cd += o.cd;
+			d2 += o.d2;
+			w += o.w;
+		}
+
+		double eval(const v3 &p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z
+				+ d2;
+			return e > 0 ? e : 0;
+		}
+
+		// weighted mean squared distance to the accumulated planes
+		double distance2(const v3 &p) const
+		{
+			return w > 0 ? eval(p) / w : 0;
+		}
+	};
+
+	struct Collapse
+	{
+		u32 from;
+		u32 to;
+		double cost;
+	};
+
+	u64 edgeKey(u32 a, u32 b)
+	{
+		return (u64(a) << 32) | b;
+	}
+}
+
+vector<u32> Simplifier::simplify(const Source &mesh, const Options &options, float *error)
+{
+	const v3 *pos = mesh.positions.data();
+	const size_t vertexCount = mesh.positions.size();
+	vector<u32> indices(mesh.indices.data(), mesh.indices.data() + mesh.indices.size());
+
+	const size_t targetIndices = std::max<size_t>(3, size_t(indices.size() / 3 * options.targetRatio) * 3);
+	if (error)
+		*error = 0;
+	if (indices.size() <= targetIndices || vertexCount == 0)
+		return indices;
+
+	v3 lo = pos[0], hi = pos[0];
+	for (size_t i = 1; i < vertexCount; ++i)
+	{
+		lo = glm::min(lo, pos[i]);
+		hi = glm::max(hi, pos[i]);
+	}
+	double extent = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1e-20f });
+	double maxCost = options.maxError < FLT_MAX ? std::pow(options.maxError * extent, 2.0) : DBL_MAX;
+
+	// a directed edge without its twin lies on the border
+	std::unordered_set<u64> directed;
+	for (size_t t = 0; t < indices.size(); t += 3)
+		for (int k = 0; k < 3; ++k)
+			directed.insert(edgeKey(indices[t + k], indices[t + (k + 1) % 3]));
+
+	vector<bool> border(vertexCount, false);
+	std::unordered_set<u64> borderEdges;
+	vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		glm::dvec3 p0(pos[indices[t]]), p1(pos[indices[t + 1]]), p2(pos[indices[t + 2]]);
+		auto n = glm::cross(p1 - p0, p2 - p0);
+		double area = glm::length(n);
+		if (area == 0)
+			continue;
+		n /= area;
+
+		// weights are areas (length^2), only their ratios matter after distance2()
+		auto q = Quadric::plane(n, -glm::dot(n, p0), area * 0.5);
+		for (int k = 0; k < 3; ++k)
+			quadrics[indices[t + k]].add(q);
+
+		for (int k = 0; k < 3; ++k)
+		{
+			u32 a = indices[t + k], b = indices[t + (k + 1) % 3];
+			if (directed.count(edgeKey(b, a)))
+				continue;
+
+			border[a] = border[b] = true;
+			borderEdges.insert(edgeKey(std::min(a, b), std::max(a, b)));
+
+			// plane through the border edge, perpendicular to the face, keeps
+			// open borders from shrinking
+			glm::dvec3 pa(pos[a]), pb(pos[b]);
+			auto edge = pb - pa;
+			auto len = glm::length(edge);
+			if (len == 0)
+				continue;
+			auto bn = glm::normalize(glm::cross(edge, n));
+			auto bq = Quadric::plane(bn, -glm::dot(bn, pa), len * len * 10);
+			quadrics[a].add(bq);
+			quadrics[b].add(bq);
+		}
+	}
+
+	// attributes are unitless, scale them by the extent so attributeWeight
+	// keeps the same meaning as maxError at any mesh size
+	auto attributeCost = [&mesh, &options, extent](u32 from, u32 to) {
+		if (mesh.attributeStride == 0)
+			return 0.0;
+		const float *a = mesh.attributes.data() + from * mesh.attributeStride;
+		const float *b = mesh.attributes.data() + to * mesh.attributeStride;
+		double sum = 0;
+		for (size_t i = 0; i < mesh.attributeStride; ++i)
+			sum += double(a[i] - b[i]) * (a[i] - b[i]);
+		return sum * options.attributeWeight * extent * extent;
+	};
+
+	auto allowed = [&](u32 from, u32 to) {
+		if (!border[from])
+			return true;
+		if (options.lockBorder)
+			return false;
+		return border[to] && borderEdges.count(edgeKey(std::min(from, to), std::max(from, to))) > 0;
+	};
+
+	double worst = 0;
+	vector<u32> offsets(vertexCount + 1);
+	vector<u32> adjacency;
+	vector<Collapse> collapses;
+	vector<bool> touched(vertexCount);
+	vector<u32> remap(vertexCount);
+
+	while (indices.size() > targetIndices)
+	{
+		// vertex -> triangle adjacency of the current index list
+		std::fill(begin(offsets), end(offsets), 0);
+		for (auto i : indices)
+			++offsets[i + 1];
+		for (size_t v = 0; v < vertexCount; ++v)
+			offsets[v + 1] += offsets[v];
+		adjacency.resize(indices.size());
+		{
+			auto fill = offsets;
+			for (size_t i = 0; i < indices.size(); ++i)
+				adjacency[fill[indices[i]]++] = static_cast<u32>(i / 3);
+		}
+
+		collapses.clear();
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				u32 a = indices[t + k], b = indices[t + (k + 1) % 3];
+				// every interior edge is seen twice, keep one
+				if (a > b && !border[a] && !border[b])
+					continue;
+
+				Collapse best{ a, b, DBL_MAX };
+				for (auto c : { Collapse{ a, b, 0 }, Collapse{ b, a, 0 } })
+				{
+					if (!allowed(c.from, c.to))
+						continue;
+					auto q = quadrics[c.from];
+					q.add(quadrics[c.to]);
+					c.cost = q.distance2(pos[c.to]) + attributeCost(c.from, c.to);
+					if (c.cost < best.cost)
+						best = c;
+				}
+				if (best.cost < DBL_MAX && best.cost <= maxCost)
+					collapses.push_back(best);
+			}
+		}
+		std::sort(begin(collapses), end(collapses), [](const Collapse &l, const Collapse &r) { return l.cost < r.cost; });
+
+		std::fill(begin(touched), end(touched), false);
+		for (u32 v = 0; v < vertexCount; ++v)
+			remap[v] = v;
+
+		size_t budget = (indices.size() - targetIndices) / 3;
+		size_t removed = 0;
+		size_t applied = 0;
+		for (const auto &c : collapses)
+		{
+			if (removed >= budget)
+				break;
+			if (touched[c.from] || touched[c.to])
+				continue;
+
+			// reject collapses that flip a triangle around the removed vertex
+			bool flips = false;
+			size_t shared = 0;
+			for (auto a = offsets[c.from]; a < offsets[c.from + 1] && !flips; ++a)
+			{
+				const u32 *tri = &indices[adjacency[a] * 3];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+				{
+					++shared;
+					continue;
+				}
+				v3 before[3], after[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					before[k] = pos[tri[k]];
+					after[k] = tri[k] == c.from ? pos[c.to] : pos[tri[k]];
+				}
+				auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+				auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(n0, n1) <= 0;
+			}
+			if (flips)
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to].add(quadrics[c.from]);
+			for (auto a = offsets[c.from]; a < offsets[c.from + 1]; ++a)
+				for (int k = 0; k < 3; ++k)
+					touched[indices[adjacency[a] * 3 + k]] = true;
+
+			worst = std::max(worst, c.cost);
+			removed += shared;
+			++applied;
+		}
+		if (applied == 0)
+			break;
+
+		size_t write = 0;
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			u32 a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+	}
+
+	if (error)
+		*error = static_cast<float>(std::sqrt(worst) / extent);
+
+	return indices;
+}
+
+Simplifier::LodChain Simplifier::lodChain(const Source &mesh, uint levels, const Options &options)
+{
+	LodChain chain;
+	chain.indices.assign(mesh.indices.data(), mesh.indices.data() + mesh.indices.size());
+	chain.lods.push_back({ 0, static_cast<u32>(mesh.indices.size()), 0 });
+
+	Source level = mesh;
+	vector<u32> previous;
+	for (uint i = 1; i < levels; ++i)
+	{
+		float error;
+		auto lod = simplify(level, options, &error);
+		// stop once simplification stalls, an identical level is useless
+		if (lod.size() >= level.indices.size())
+			break;
+
+		chain.lods.push_back({ static_cast<u32>(chain.indices.size()), static_cast<u32>(lod.size()),
+			std::max(error, chain.lods.back().error) });
+		chain.indices.insert(end(chain.indices), begin(lod), end(lod));
+
+		previous = std::move(lod);
+		level.indices = previous;
+	}
+
+	return chain;
+}
+
+vector<Simplifier::LodChain> Simplifier::lodChains(tf::Executor &executor, const vector<Source> &meshes, uint levels, const Options &options)
+{
+	vector<LodChain> chains(meshes.size());
+
+	tf::Taskflow taskflow;
+	taskflow.parallel_for(size_t(0), meshes.size(), size_t(1), [&](size_t i) {
+		chains[i] = lodChain(meshes[i], levels, options);
+	});
+	executor.run(taskflow).get();
+
+	return chains;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "types.hh"
+#include "mesh.hh"
+#include <cfloat>
+
+namespace tf { class Executor; }
+
+// Edge collapse simplification driven by quadric error metrics
+// (Garland & Heckbert 1997). Vertices collapse onto one of their neighbours,
+// so the vertex buffer stays untouched and only indices are rewritten.
+class Simplifier
+{
+public:
+	struct Options
+	{
+		float targetRatio{ 0.5f };
+		// relative to the mesh extent, collapses above it are not done
+		float maxError{ FLT_MAX };
+		// border vertices never move, keeps seams between meshes closed
+		bool lockBorder{ false };
+		// scales the attribute term of Source::attributes in the error, an
+		// attribute difference of 1 costs as much as moving sqrt(attributeWeight)
+		// times the mesh extent
+		float attributeWeight{ 1.0f };
+	};
+
+	struct Source
+	{
+		Span<v3> positions;
+		Span<u32> indices;
+		// optional per-vertex attributes (normals, uvs...) mixed into the error,
+		// attributeStride floats per vertex
+		Span<float> attributes;
+		size_t attributeStride{ 0 };
+	};
+
+	struct Lod
+	{
+		u32 firstIndex{ 0 };
+		u32 indexCount{ 0 };
+		float error{ 0 };
+	};
+
+	// all levels share one index array, switching LOD only changes the
+	// draw's first index and count
+	struct LodChain
+	{
+		vector<u32> indices;
+		vector<Lod> lods;
+	};
+
+	static vector<u32> simplify(const Source &mesh, const Options &options, float *error = nullptr);
+
+	// level 0 is the source, each next level keeps options.targetRatio of the previous one
+	static LodChain lodChain(const Source &mesh, uint levels, const Options &options);
+	static vector<LodChain> lodChains(tf::Executor &executor, const vector<Source> &meshes, uint levels, const Options &options);
+
+	template <typename V>
+	static Source source(const MeshData<V> &mesh, vector<v3> &positions, v3 V::*position)
+	{
+		positions.clear();
+		positions.reserve(mesh.verts.size());
+		for (const auto &v : mesh.verts)
+			positions.push_back(v.*position);
+		return { positions, mesh.indices, {}, 0 };
+	}
+};
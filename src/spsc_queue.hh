@@ -0,0 +1,44 @@
+#pragma once
+#include "types.hh"
+#include <atomic>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+template <typename T, size_t N>
+class SpscQueue
+{
+	static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+	bool push(T &&value)
+	{
+		auto tail = writeIdx.load(std::memory_order_relaxed);
+		if (tail - readIdx.load(std::memory_order_acquire) == N)
+			return false;
+
+		items[tail & (N - 1)] = std::move(value);
+		writeIdx.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &out)
+	{
+		auto head = readIdx.load(std::memory_order_relaxed);
+		if (head == writeIdx.load(std::memory_order_acquire))
+			return false;
+
+		out = std::move(items[head & (N - 1)]);
+		readIdx.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const
+	{
+		return readIdx.load(std::memory_order_acquire) == writeIdx.load(std::memory_order_acquire);
+	}
+
+private:
+	T items[N];
+	alignas(64) std::atomic<size_t> writeIdx{ 0 };
+	alignas(64) std::atomic<size_t> readIdx{ 0 };
+};
@@ -0,0 +1,83 @@
+#include "stream_buffer.hh"
+#include "log.hh"
+
+bool StreamBuffer::create(size_t _regionSize, uint frames)
+{
+	const uint flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	regionSize = _regionSize;
+	fences.assign(frames, nullptr);
+	frame = 0;
+	head = 0;
+
+	buffer = gl.buffer.create();
+	gl.buffer.storage(buffer, regionSize * frames, nullptr, flags);
+	mapped = static_cast<byte *>(gl.buffer.mapRange(buffer, 0, regionSize * frames, flags));
+
+	bool success = mapped != nullptr;
+	status(success ? std::cout : std::cerr, "stream_buffer", success);
+	if (!success)
+		del();
+
+	return success;
+}
+
+void StreamBuffer::del()
+{
+	for (auto &fence : fences)
+	{
+		if (fence)
+			gl.sync.del(fence);
+		fence = nullptr;
+	}
+
+	if (buffer)
+	{
+		if (mapped)
+			gl.buffer.unmap(buffer);
+		gl.buffer.del(buffer);
+	}
+	buffer = 0;
+	mapped = nullptr;
+}
+
+void StreamBuffer::beginFrame()
+{
+	auto &fence = fences[frame];
+	if (fence)
+	{
+		// the common case is an already signaled fence, only count real waits
+		if (gl.sync.clientWait(fence, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			++stallCount;
+			while (gl.sync.clientWait(fence, 1000000) == GL_TIMEOUT_EXPIRED)
+				;
+		}
+		gl.sync.del(fence);
+		fence = nullptr;
+	}
+	head = 0;
+}
+
+void StreamBuffer::endFrame()
+{
+	fences[frame] = gl.sync.fence();
+	frame = (frame + 1) % fences.size();
+}
+
+StreamBuffer::Allocation StreamBuffer::alloc(size_t bytes, size_t align)
+{
+	size_t base = regionSize * frame;
+	size_t offset = base + head;
+	if (align > 1)
+		offset = (offset + align - 1) / align * align;
+
+	if (offset + bytes > base + regionSize)
+	{
+		std::cerr << "stream_buffer: out of space (" << bytes << " bytes requested)\n";
+		return {};
+	}
+	head = offset + bytes - base;
+
+	return { buffer, offset, mapped + offset };
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include <cstring>
+#include <type_traits>
+
+// Persistently mapped ring buffer split into one region per frame in flight.
+// A region is only reused after the fence placed at the end of its frame
+// has signaled, so writes never race the GPU and never hit an implicit sync.
+class StreamBuffer
+{
+public:
+	struct Allocation
+	{
+		uint buffer{ 0 };
+		size_t offset{ 0 };
+		void *ptr{ nullptr };
+
+		explicit operator bool() const { return ptr != nullptr; }
+	};
+
+	bool create(size_t regionSize, uint frames = 3);
+	void del();
+
+	void beginFrame();
+	void endFrame();
+
+	Allocation alloc(size_t bytes, size_t align = 4);
+
+	template <typename T>
+	Allocation write(const vector<T> &vv)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "stream buffer needs trivially copyable elements");
+		auto a = alloc(sizeof(T) * vv.size(), sizeof(T));
+		if (a)
+			std::memcpy(a.ptr, vv.data(), sizeof(T) * vv.size());
+		return a;
+	}
+
+	// base vertex of an allocation made with write<T>, for Draw::elementsBaseVertex
+	template <typename T>
+	static int baseVertex(const Allocation &a)
+	{
+		return static_cast<int>(a.offset / sizeof(T));
+	}
+
+	uint id() const { return buffer; }
+	size_t used() const { return head; }
+	size_t capacity() const { return regionSize; }
+	uint stalls() const { return stallCount; }
+
+private:
+	GL gl;
+	uint buffer{ 0 };
+	byte *mapped{ nullptr };
+	size_t regionSize{ 0 };
+	size_t head{ 0 };
+	uint frame{ 0 };
+	uint stallCount{ 0 };
+	vector<GLsync> fences;
+};
@@ -0,0 +1,171 @@
+#include "textures.hh"
+#include "log.hh"
+#include <taskflow.hpp>
+#include <chrono>
+#include <cstring>
+
+Textures::Textures() = default;
+
+Textures::~Textures()
+{
+	// decode tasks write into the batch, never leave them running
+	if (batch)
+		batch->done.wait();
+}
+
+bool Textures::create(tf::Executor &_executor, size_t uploadBytesPerFrame)
+{
+	executor = &_executor;
+	return staging.create(uploadBytesPerFrame);
+}
+
+void Textures::del()
+{
+	if (batch)
+		batch->done.wait();
+	batch.reset();
+
+	for (auto &e : entries)
+		if (e.texture)
+			gl.texture.del(e.texture);
+
+	entries.clear();
+	queued.clear();
+	uploading.clear();
+	pendingCount = 0;
+	staging.del();
+}
+
+Textures::Handle Textures::load(const string &path, Desc desc)
+{
+	Handle h = static_cast<Handle>(entries.size());
+	Entry e;
+	e.path = path;
+	e.desc = desc;
+	entries.push_back(std::move(e));
+	queued.push_back(h);
+	++pendingCount;
+	return h;
+}
+
+void Textures::update()
+{
+	if (batch && batch->done.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		finishBatch();
+	if (!batch && !queued.empty())
+		startBatch();
+
+	if (uploading.empty())
+		return;
+
+	staging.beginFrame();
+	gl.texture.unpackAlignment(1);
+
+	size_t done = 0;
+	for (; done < uploading.size(); ++done)
+		if (!upload(entries[uploading[done]]))
+			break;
+	uploading.erase(begin(uploading), begin(uploading) + done);
+
+	gl.buffer.bind(GL_PIXEL_UNPACK_BUFFER, 0);
+	gl.texture.unpackAlignment(4);
+	staging.endFrame();
+}
+
+void Textures::bind(uint unit, Handle h)
+{
+	gl.texture.bindUnit(unit, ready(h) ? entries[h].texture : 0);
+}
+
+void Textures::startBatch()
+{
+	batch = std::make_unique<Batch>();
+	batch->taskflow = std::make_unique<tf::Taskflow>();
+	for (auto h : queued)
+	{
+		entries[h].state = State::Decoding;
+		batch->jobs.push_back({ h, entries[h].path, entries[h].desc, {} });
+	}
+	queued.clear();
+
+	// jobs is not resized while the taskflow runs
+	for (auto &job : batch->jobs)
+	{
+		batch->taskflow->emplace([&job]() {
+			auto img = Images::load(job.path);
+			if (!img.valid())
+				return;
+			auto mips = job.desc.mips == Mips::Cpu ? Images::mips(img, job.desc.srgb) : vector<Image>{};
+			job.levels.reserve(mips.size() + 1);
+			job.levels.push_back(std::move(img));
+			for (auto &m : mips)
+				job.levels.push_back(std::move(m));
+		});
+	}
+	batch->done = executor->run(*batch->taskflow);
+}
+
+void Textures::finishBatch()
+{
+	for (auto &job : batch->jobs)
+	{
+		auto &e = entries[job.handle];
+		if (job.levels.empty())
+		{
+			e.state = State::Failed;
+			--pendingCount;
+			status(std::cerr, "texture/" + e.path, false);
+			continue;
+		}
+
+		const auto &base = job.levels.front();
+		int levels = e.desc.mips == Mips::None ? 1 : GL::Texture::levels(base.width, base.height);
+		e.texture = gl.texture.create(GL_TEXTURE_2D);
+		gl.texture.storage2D(e.texture, levels, base.internalFormat(e.desc.srgb), base.width, base.height);
+		gl.texture.parameter(e.texture, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+		e.levels = std::move(job.levels);
+		e.nextLevel = 0;
+		e.state = State::Uploading;
+		uploading.push_back(job.handle);
+	}
+	batch.reset();
+}
+
+// false when the frame budget is used up, the entry continues next frame
+bool Textures::upload(Entry &e)
+{
+	while (e.nextLevel < e.levels.size())
+	{
+		auto &img = e.levels[e.nextLevel];
+		int level = static_cast<int>(e.nextLevel);
+
+		if (img.bytes() > staging.capacity())
+		{
+			// larger than a whole staging region, upload straight from memory
+			gl.buffer.bind(GL_PIXEL_UNPACK_BUFFER, 0);
+			gl.texture.subImage2D(e.texture, level, 0, 0, img.width, img.height, img.format(), img.type(), img.pixels.data());
+		}
+		else
+		{
+			if (staging.used() + img.bytes() + 4 > staging.capacity())
+				return false;
+			auto a = staging.alloc(img.bytes(), 4);
+			std::memcpy(a.ptr, img.pixels.data(), img.bytes());
+			gl.buffer.bind(GL_PIXEL_UNPACK_BUFFER, a.buffer);
+			gl.texture.subImage2D(e.texture, level, 0, 0, img.width, img.height, img.format(), img.type(), reinterpret_cast<const void *>(a.offset));
+		}
+
+		img = {};
+		++e.nextLevel;
+	}
+
+	if (e.desc.mips == Mips::Gpu)
+		gl.texture.generateMipmap(e.texture);
+
+	e.levels.clear();
+	e.state = State::Ready;
+	--pendingCount;
+	status(std::cout, "texture/" + e.path, true);
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include "image.hh"
+#include "stream_buffer.hh"
+#include <future>
+#include <memory>
+
+namespace tf { class Executor; class Taskflow; }
+
+// Asynchronous texture loading. Files are read, decoded and mip mapped on
+// the executor; update() hands finished images to GL through a streamed
+// pixel unpack buffer with a per frame byte budget, so loading never
+// stalls the frame. Textures are usable once ready() returns true.
+class Textures
+{
+public:
+	using Handle = uint;
+	static constexpr Handle Invalid = ~0u;
+
+	enum class Mips : u8
+	{
+		None,
+		Cpu,
+		Gpu,
+	};
+
+	struct Desc
+	{
+		bool srgb{ true };
+		Mips mips{ Mips::Cpu };
+	};
+
+	Textures();
+	~Textures();
+
+	bool create(tf::Executor &executor, size_t uploadBytesPerFrame = 16 << 20);
+	void del();
+
+	Handle load(const string &path) { return load(path, Desc()); }
+	Handle load(const string &path, Desc desc);
+	void update();
+
+	uint id(Handle h) const { return entries[h].texture; }
+	bool ready(Handle h) const { return entries[h].state == State::Ready; }
+	uint pending() const { return pendingCount; }
+	// binds nothing until the texture is ready
+	void bind(uint unit, Handle h);
+
+private:
+	enum class State : u8
+	{
+		Queued,
+		Decoding,
+		Uploading,
+		Ready,
+		Failed,
+	};
+
+	struct Entry
+	{
+		string path;
+		Desc desc;
+		State state{ State::Queued };
+		uint texture{ 0 };
+		vector<Image> levels;
+		size_t nextLevel{ 0 };
+	};
+
+	// images decoded together in one taskflow run
+	struct Batch
+	{
+		struct Job
+		{
+			Handle handle;
+			string path;
+			Desc desc;
+			vector<Image> levels;
+		};
+
+		vector<Job> jobs;
+		std::unique_ptr<tf::Taskflow> taskflow;
+		std::future<void> done;
+	};
+
+	void startBatch();
+	void finishBatch();
+	bool upload(Entry &e);
+
+	GL gl;
+	tf::Executor *executor{ nullptr };
+	StreamBuffer staging;
+	vector<Entry> entries;
+	vector<Handle> queued;
+	vector<Handle> uploading;
+	std::unique_ptr<Batch> batch;
+	uint pendingCount{ 0 };
+};
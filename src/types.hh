@@ -1,6 +1,7 @@
 #pragma once
 
 #include "glm.hh"
+#include <iterator>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -8,13 +9,24 @@
 using v2 = glm::vec2;
 using v3 = glm::vec3;
 using v4 = glm::vec4;
+using iv2 = glm::ivec2;
+using iv3 = glm::ivec3;
+using iv4 = glm::ivec4;
+using uv2 = glm::uvec2;
+using uv3 = glm::uvec3;
+using uv4 = glm::uvec4;
+using mat2 = glm::mat2;
+using mat3 = glm::mat3;
 using mat4 = glm::mat4;
 using quat = glm::quat;
 
+using i16 = std::int16_t;
 using i32 = std::int32_t;
 using i64 = std::int64_t;
 using uint = unsigned int;
 using byte = std::uint8_t;
+using u8 = std::uint8_t;
+using u16 = std::uint16_t;
 using u32 = std::uint32_t;
 using u64 = std::uint64_t;
 
@@ -27,6 +39,27 @@ using unordered_map = std::unordered_map<K, V>;
 template <typename K>
 using vector = std::vector<K>;
 
+// non-owning view over contiguous elements
+template <typename T>
+struct Span
+{
+	const T *ptr{ nullptr };
+	size_t count{ 0 };
+
+	Span() = default;
+	Span(const T *_ptr, size_t _count) : ptr(_ptr), count(_count) {}
+
+	template <typename C>
+	Span(const C &c) : ptr(std::data(c)), count(std::size(c)) {}
+
+	const T *data() const { return ptr; }
+	size_t size() const { return count; }
+	size_t bytes() const { return sizeof(T) * count; }
+	bool empty() const { return count == 0; }
+
+	Span sub(size_t first, size_t n) const { return { ptr + first, n }; }
+};
+
 using Dimension = struct { int w, h; };
 
 v4 rgb(byte r, byte g, byte b, byte a = 255);
@@ -0,0 +1,42 @@
+#include "uniform_blocks.hh"
+#include <algorithm>
+
+bool UniformBlocks::create(uint maxBlocks, uint frames)
+{
+	alignment = static_cast<size_t>(gl.getInt(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT));
+	if (alignment == 0)
+		alignment = 256;
+
+	size_t largest = std::max(sizeof(FrameUniforms), sizeof(ObjectUniforms));
+	size_t slot = (largest + alignment - 1) / alignment * alignment;
+	return stream.create(slot * maxBlocks, frames);
+}
+
+void UniformBlocks::del()
+{
+	stream.del();
+}
+
+void UniformBlocks::beginFrame(const mat4 &view, const mat4 &proj, float time)
+{
+	stream.beginFrame();
+
+	current.view = view;
+	current.proj = proj;
+	current.viewProj = proj * view;
+	current.time = v4(time, 0, 0, 0);
+	bind(FrameBinding, current);
+}
+
+void UniformBlocks::endFrame()
+{
+	stream.endFrame();
+}
+
+bool UniformBlocks::object(const mat4 &model)
+{
+	ObjectUniforms block;
+	block.model = model;
+	block.mvp = current.viewProj * model;
+	return bind(ObjectBinding, block);
+}
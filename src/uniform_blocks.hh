@@ -0,0 +1,64 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include "stream_buffer.hh"
+#include <cstring>
+#include <type_traits>
+
+// std140 mirrors of the blocks declared in the pass shaders, mat4 and vec4
+// members only so the C++ layout matches std140 without manual padding
+struct FrameUniforms
+{
+	mat4 view;
+	mat4 proj;
+	mat4 viewProj;
+	v4 time; // x: seconds since start
+};
+
+struct ObjectUniforms
+{
+	mat4 model;
+	mat4 mvp;
+};
+
+// Per-frame and per-object uniform blocks sub-allocated from one streamed
+// UBO. Every block is written once and bound with glBindBufferRange, so a
+// draw costs one range bind instead of a lookup and upload per matrix.
+class UniformBlocks
+{
+public:
+	static constexpr uint FrameBinding = 0;
+	static constexpr uint ObjectBinding = 1;
+
+	// room for maxBlocks aligned blocks per frame in flight
+	bool create(uint maxBlocks = 4096, uint frames = 3);
+	void del();
+
+	void beginFrame(const mat4 &view, const mat4 &proj, float time);
+	void endFrame();
+
+	// MVP is multiplied here so the vertex shader does one transform
+	bool object(const mat4 &model);
+
+	template <typename T>
+	bool bind(uint binding, const T &block)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "uniform blocks need trivially copyable data");
+		static_assert(sizeof(T) % 16 == 0, "std140 blocks are padded to vec4");
+		auto a = stream.alloc(sizeof(T), alignment);
+		if (!a)
+			return false;
+		std::memcpy(a.ptr, &block, sizeof(T));
+		gl.buffer.bindRange(GL_UNIFORM_BUFFER, binding, a.buffer, a.offset, sizeof(T));
+		return true;
+	}
+
+	const FrameUniforms& frame() const { return current; }
+	size_t used() const { return stream.used(); }
+
+private:
+	GL gl;
+	StreamBuffer stream;
+	FrameUniforms current;
+	size_t alignment{ 256 };
+};
@@ -0,0 +1,88 @@
+#include "upload_worker.hh"
+#include "log.hh"
+
+bool UploadWorker::start(GLFWwindow *shared)
+{
+	glfw.window.hintVisible(false);
+	wnd = glfw.window.create(1, 1, "uploads", shared);
+	glfw.window.hintVisible(true);
+
+	status(wnd ? std::cout : std::cerr, "upload_worker", wnd != nullptr);
+	if (!wnd)
+		return false;
+
+	running = true;
+	thread = std::thread(&UploadWorker::run, this);
+	return true;
+}
+
+void UploadWorker::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!running)
+			return;
+		running = false;
+	}
+	wake.notify_one();
+	thread.join();
+
+	glfw.window.destroy(wnd);
+	wnd = nullptr;
+}
+
+UploadWorker::~UploadWorker()
+{
+	stop();
+}
+
+u64 UploadWorker::buffer(vector<byte> &&data, uint storageFlags)
+{
+	auto ticket = nextTicket++;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({ ticket, std::move(data), storageFlags });
+	}
+	wake.notify_one();
+	return ticket;
+}
+
+void UploadWorker::run()
+{
+	glfw.window.makeContextCurrent(wnd);
+
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return !running || !jobs.empty(); });
+			if (!running)
+				break;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		Result result{ job.ticket, gl.buffer.create(), job.data.size() };
+		gl.buffer.storage(result.buffer, job.data.size(), job.data.data(), job.flags);
+
+		// the name may only be used by the other context once the upload is done
+		auto fence = gl.sync.fence();
+		while (gl.sync.clientWait(fence, 1000000) == GL_TIMEOUT_EXPIRED)
+			;
+		gl.sync.del(fence);
+
+		// nobody polls once stopping, the name would never be handed out
+		while (!done.push(std::move(result)))
+		{
+			if (!running)
+			{
+				gl.buffer.del(result.buffer);
+				break;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	glfw.window.makeContextCurrent(nullptr);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include "glfw.hh"
+#include "spsc_queue.hh"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// Uploads on a background thread through a hidden window whose context is
+// shared with the main one. Finished uploads are fenced and waited for on
+// the worker, so names popped by the render thread are ready to use.
+class UploadWorker
+{
+public:
+	struct Result
+	{
+		u64 ticket{ 0 };
+		uint buffer{ 0 };
+		size_t size{ 0 };
+	};
+
+	// must be called on the main thread, GLFW only creates windows there
+	bool start(GLFWwindow *shared);
+	void stop();
+	~UploadWorker();
+
+	// returns a ticket matched by Result::ticket
+	u64 buffer(vector<byte> &&data, uint storageFlags = 0);
+
+	template <typename Range>
+	u64 buffer(const Range &r, uint storageFlags = 0)
+	{
+		auto s = GL::Buffer::span(r);
+		auto bytes = reinterpret_cast<const byte *>(s.data());
+		return buffer(vector<byte>(bytes, bytes + s.bytes()), storageFlags);
+	}
+
+	// render thread, non-blocking
+	bool poll(Result &out) { return done.pop(out); }
+
+private:
+	struct Job
+	{
+		u64 ticket;
+		vector<byte> data;
+		uint flags;
+	};
+
+	void run();
+
+	GL gl;
+	GLFW glfw;
+	GLFWwindow *wnd{ nullptr };
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> jobs;
+	// written under mutex, also read by the worker while the result queue is full
+	std::atomic<bool> running{ false };
+	std::atomic<u64> nextTicket{ 1 };
+	SpscQueue<Result, 256> done;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include "types.hh"
+#include "gl.hh"
+#include <array>
+#include <type_traits>
+#include <utility>
+
+// component count and GL type of a vertex attribute's C++ type
+template <typename T>
+struct AttrFormat;
+
+template <> struct AttrFormat<float> { static constexpr int size = 1; static constexpr uint type = GL_FLOAT; static constexpr bool normalized = false; static constexpr bool integer = false; };
+template <> struct AttrFormat<v2> { static constexpr int size = 2; static constexpr uint type = GL_FLOAT; static constexpr bool normalized = false; static constexpr bool integer = false; };
+template <> struct AttrFormat<v3> { static constexpr int size = 3; static constexpr uint type = GL_FLOAT; static constexpr bool normalized = false; static constexpr bool integer = false; };
+template <> struct AttrFormat<v4> { static constexpr int size = 4; static constexpr uint type = GL_FLOAT; static constexpr bool normalized = false; static constexpr bool integer = false; };
+template <> struct AttrFormat<u32> { static constexpr int size = 1; static constexpr uint type = GL_UNSIGNED_INT; static constexpr bool normalized = false; static constexpr bool integer = true; };
+
+template <uint Location, typename T>
+struct Attr
+{
+	using type = T;
+	using format = AttrFormat<T>;
+	static constexpr uint location = Location;
+	static constexpr size_t bytes = sizeof(T);
+};
+
+// Interleaved vertex layout, attributes are packed in declaration order:
+//   using PassLayout = VertexLayout<Attr<0, v3>, Attr<1, v3>>;
+template <typename... Attrs>
+struct VertexLayout
+{
+	static constexpr size_t count = sizeof...(Attrs);
+	static constexpr size_t stride = (Attrs::bytes + ... + 0);
+	static constexpr std::array<size_t, count> offsets = []() {
+		std::array<size_t, count> sizes{ Attrs::bytes... };
+		std::array<size_t, count> out{};
+		size_t offset = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			out[i] = offset;
+			offset += sizes[i];
+		}
+		return out;
+	}();
+
+	template <typename V>
+	static constexpr bool matches = std::is_trivially_copyable_v<V> && sizeof(V) == stride;
+
+	// describes the attributes once, buffers are attached with bind()
+	static void setup(uint vao, uint binding = 0)
+	{
+		setup(vao, binding, std::index_sequence_for<Attrs...>{});
+	}
+
+	static void bind(uint vao, uint buf, size_t offset = 0, uint binding = 0)
+	{
+		GL gl;
+		gl.vertexArray.vertexBuffer(vao, binding, buf, offset, static_cast<int>(stride));
+	}
+
+private:
+	template <size_t... I>
+	static void setup(uint vao, uint binding, std::index_sequence<I...>)
+	{
+		GL gl;
+		(setupAttr<Attrs>(gl, vao, binding, static_cast<uint>(offsets[I])), ...);
+	}
+
+	template <typename A>
+	static void setupAttr(GL &gl, uint vao, uint binding, uint offset)
+	{
+		using F = typename A::format;
+		gl.vertexArray.enableAttrib(vao, A::location);
+		if constexpr (F::integer)
+			gl.vertexArray.attribIFormat(vao, A::location, F::size, F::type, offset);
+		else
+			gl.vertexArray.attribFormat(vao, A::location, F::size, F::type, F::normalized, offset);
+		gl.vertexArray.attribBinding(vao, A::location, binding);
+	}
+};